@@ -0,0 +1,85 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+ /**
+  * @brief Declares the shared view of incoming message arguments.
+  */
+
+ #pragma once
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <udjat/tools/dbus/defs.h>
+ #include <vector>
+ #include <mutex>
+
+ namespace Udjat {
+
+	namespace DBus {
+
+		/// @brief Arguments of an incoming message, decoded once and shared by all subscribers.
+		/// @details The arguments are decoded on first access; every Message built from it
+		/// keeps its own cursor, so the subscribers don't interfere with each other.
+		class UDJAT_PRIVATE Arguments {
+		public:
+
+			/// @brief Decoded argument.
+			struct Entry {
+				int type;				///< @brief Argument type, variants are replaced by its contents.
+				DBusBasicValue value;	///< @brief Argument value (only for basic types).
+				DBusMessageIter iter;	///< @brief Iterator on the argument position.
+			};
+
+		private:
+			DBusMessage *msg;
+
+			mutable std::once_flag decoded;
+			mutable std::vector<Entry> entries;
+
+			void decode() const;
+
+		public:
+			Arguments(DBusMessage *message);
+			~Arguments();
+
+			Arguments(const Arguments &) = delete;
+			Arguments & operator=(const Arguments &) = delete;
+
+			inline DBusMessage * message() const noexcept {
+				return msg;
+			}
+
+			/// @brief Get the decoded arguments, decode them on first call.
+			const std::vector<Entry> & get() const;
+
+			inline size_t size() const {
+				return get().size();
+			}
+
+			inline const Entry & operator[](size_t index) const {
+				return get()[index];
+			}
+
+		};
+
+	}
+
+ }
+
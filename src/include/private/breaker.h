@@ -0,0 +1,132 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+ /**
+  * @brief Declares the per-destination circuit breaker.
+  */
+
+ #pragma once
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <udjat/tools/dbus/defs.h>
+ #include <unordered_map>
+ #include <string>
+ #include <mutex>
+ #include <memory>
+ #include <chrono>
+
+ namespace Udjat {
+
+	namespace DBus {
+
+		/// @brief Fail calls to a dead destination immediately, instead of waiting for the timeout.
+		/// @details The circuit opens after a number of consecutive ServiceUnknown/NoReply errors;
+		/// while open the calls fail without touching the bus, after the interval one call is
+		/// sent as a probe (half-open) and its result closes or reopens the circuit; if there's
+		/// no result after another interval a new probe is sent. A new owner for the destination
+		/// closes it.
+		class UDJAT_PRIVATE CircuitBreaker : public std::enable_shared_from_this<CircuitBreaker> {
+		private:
+
+			struct State {
+				enum : uint8_t {
+					Closed,		///< @brief Calls are sent.
+					Open,		///< @brief Calls fail immediately.
+					HalfOpen	///< @brief The probe call is running.
+				} state = Closed;
+
+				/// @brief Consecutive failures.
+				unsigned int failures = 0;
+
+				/// @brief When the circuit was opened or the probe was sent.
+				std::chrono::steady_clock::time_point opened;
+
+				/// @brief Owner watcher id.
+				size_t watcher = 0;
+
+				/// @brief True if the owner is watched, or being watched.
+				bool watched = false;
+
+				/// @brief Admitted calls without a result, they keep pointers to the key.
+				size_t calls = 0;
+			};
+
+			Connection &connection;
+
+			/// @brief Connection name for the messages from pending calls, they can outlive it.
+			const std::string name;
+
+			std::mutex guard;
+
+			/// @brief States by destination, removed when closed and without calls.
+			std::unordered_map<std::string,State> destinations;
+
+			const unsigned int threshold;
+			const std::chrono::milliseconds interval;
+
+			/// @brief The destination has a new owner, close the circuit.
+			void reset(const char *destination) noexcept;
+
+			/// @brief Remove an owner watcher.
+			void unwatch(size_t id) noexcept;
+
+			/// @brief A call finished, remove the destination if it's healthy and idle (with the guard).
+			/// @return The watcher to remove, without the guard; 0 if none.
+			size_t finish(std::unordered_map<std::string,State>::iterator it) noexcept;
+
+		public:
+
+			/// @brief Error name for calls rejected by an open circuit.
+			static constexpr const char *error_name = DBUS_ERROR_SERVICE_UNKNOWN;
+
+			CircuitBreaker(Connection &connection, unsigned int failures, unsigned int interval);
+
+			CircuitBreaker(const CircuitBreaker &) = delete;
+			CircuitBreaker & operator=(const CircuitBreaker &) = delete;
+
+			/// @brief Check if a call to the message destination can be sent.
+			/// @param message The method call.
+			/// @param key Receives the destination key for record(), nullptr if not tracked.
+			/// @return false if the circuit is open.
+			bool admit(DBusMessage *message, const std::string **key);
+
+			/// @brief Record the result of a call.
+			/// @param key The destination key from admit().
+			/// @param error The error name, nullptr on success.
+			void record(const std::string *key, const char *error) noexcept;
+
+			/// @brief The call admitted wasn't sent, there's no result to record.
+			/// @param key The destination key from admit().
+			void cancel(const std::string *key) noexcept;
+
+			/// @brief Remove the owner watchers.
+			/// @details Called by the connection, the breaker can outlive it on pending calls.
+			void unwatch() noexcept;
+
+			/// @brief Fill error for a call rejected by admit().
+			static void set_error(DBusError *error, DBusMessage *message);
+
+		};
+
+	}
+
+ }
+
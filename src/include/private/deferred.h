@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+ /**
+  * @brief Declares the queue of callbacks delivered from the main loop.
+  */
+
+ #pragma once
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <udjat/tools/mainloop.h>
+ #include <deque>
+ #include <mutex>
+ #include <functional>
+
+ namespace Udjat {
+
+	namespace DBus {
+
+		/// @brief Results known before the call, delivered from the main loop like a reply.
+		/// @details Used when a call completes without touching the bus, so the callback is
+		/// never invoked from inside the method that started it.
+		class UDJAT_PRIVATE Deferred : public MainLoop::Timer {
+		private:
+			std::mutex guard;
+			std::deque<std::function<void()>> pending;
+
+			Deferred() = default;
+
+		protected:
+			void on_timer() override;
+
+		public:
+			Deferred(const Deferred &) = delete;
+			Deferred & operator=(const Deferred &) = delete;
+
+			static Deferred & getInstance();
+
+			virtual ~Deferred();
+
+			/// @brief Queue callback for the next main loop iteration.
+			void push_back(std::function<void()> callback);
+
+		};
+
+	}
+
+ }
@@ -0,0 +1,91 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+ /**
+  * @brief Declares the single-flight table.
+  */
+
+ #pragma once
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <udjat/tools/dbus/defs.h>
+ #include <unordered_map>
+ #include <string>
+ #include <vector>
+ #include <mutex>
+ #include <memory>
+
+ namespace Udjat {
+
+	namespace DBus {
+
+		/// @brief Identical method calls in flight, sharing a single reply.
+		class UDJAT_PRIVATE Flights : public std::enable_shared_from_this<Flights> {
+		public:
+
+			/// @brief Outstanding call and the records waiting for its reply.
+			class Flight {
+			private:
+				friend class Flights;
+
+				/// @brief The table, empty after landing.
+				std::shared_ptr<Flights> table;
+
+				std::string key;
+				std::vector<PendingCall *> followers;
+
+			public:
+
+				/// @brief Remove from the table.
+				/// @return The records that joined this call.
+				std::vector<PendingCall *> land();
+
+			};
+
+		private:
+			std::mutex guard;
+			std::unordered_map<std::string,std::shared_ptr<Flight>> flights;
+
+			size_t sent = 0;
+			size_t joined = 0;
+
+			/// @brief Build key from the request, empty if it can't be shared.
+			static std::string KeyFactory(DBusMessage *message);
+
+		public:
+
+			/// @brief Join an identical call in flight.
+			/// @param message The method call.
+			/// @param record The pending call record; if it's the first one the flight is set on it.
+			/// @return true if the record joined an outstanding call, don't send the message.
+			bool join(DBusMessage *message, PendingCall *record);
+
+			/// @brief Get counters.
+			/// @param sent Calls sent to the bus.
+			/// @param joined Calls that got the reply of another one.
+			void statistics(size_t &sent, size_t &joined) noexcept;
+
+		};
+
+	}
+
+ }
+
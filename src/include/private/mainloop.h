@@ -31,14 +31,17 @@
  using namespace std;
  using namespace Udjat;
 
+ /// @brief Per connection dispatcher (defined in watch.cc).
+ class UDJAT_PRIVATE Dispatcher;
+
  extern "C" {
 
-	UDJAT_PRIVATE void handle_dispatch_status(DBusConnection *c, DBusDispatchStatus status, DBus::Connection *connection);
+	UDJAT_PRIVATE void handle_dispatch_status(DBusConnection *c, DBusDispatchStatus status, Dispatcher *dispatcher);
 
 	UDJAT_PRIVATE dbus_bool_t add_watch(DBusWatch *w, DBusConnection *connection);
 	UDJAT_PRIVATE void remove_watch(DBusWatch *w, DBusConnection *connection);
 	UDJAT_PRIVATE void toggle_watch(DBusWatch *w, DBusConnection *connection);
-	UDJAT_PRIVATE void wake_up(DBusConnection *connection);
+	UDJAT_PRIVATE void wake_up(Dispatcher *dispatcher);
 
 	UDJAT_PRIVATE dbus_bool_t add_timeout(DBusTimeout *t, DBusConnection *connection);
 	UDJAT_PRIVATE void remove_timeout(DBusTimeout *t, DBusConnection *connection);
@@ -47,4 +50,16 @@
 	UDJAT_PRIVATE void mainloop_add(DBusConnection *connection);
 	UDJAT_PRIVATE void mainloop_remove(DBusConnection *connection);
 
+	/// @brief Read and dispatch from the main loop.
+	UDJAT_PRIVATE void mainloop_watch_add(DBusConnection *connection);
+
+	/// @brief Stop reading from the main loop.
+	UDJAT_PRIVATE void mainloop_watch_remove(DBusConnection *connection);
+
+	/// @brief Run the connection timeouts on the main loop timer wheel.
+	UDJAT_PRIVATE void mainloop_add_timeouts(DBusConnection *connection);
+
+	/// @brief Release the connection timeouts from the main loop timer wheel.
+	UDJAT_PRIVATE void mainloop_remove_timeouts(DBusConnection *connection);
+
  }
@@ -0,0 +1,166 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+ /**
+  * @brief Declares the pooled pending call records.
+  */
+
+ #pragma once
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <udjat/tools/dbus/defs.h>
+ #include <udjat/tools/dbus/deadline.h>
+ #include <private/flights.h>
+ #include <private/throttle.h>
+ #include <cstddef>
+ #include <memory>
+ #include <string>
+ #include <new>
+ #include <type_traits>
+ #include <utility>
+
+ namespace Udjat {
+
+	namespace DBus {
+
+		/// @brief Fixed size record for an asynchronous method call.
+		/// @details Records are recycled from a pool and small callbacks are stored
+		/// inline, so sending a call doesn't touch the heap once the pool is warm.
+		class UDJAT_PRIVATE PendingCall {
+		private:
+			class Pool;
+
+			PendingCall *next = nullptr;
+
+			/// @brief True if the record belongs to a pool block, false if it was allocated alone.
+			bool pooled = false;
+
+			/// @brief Inline storage for the callback, larger ones are kept on the heap.
+			static constexpr size_t capacity = 64;
+			alignas(std::max_align_t) unsigned char storage[capacity];
+
+			void (*invoke)(void *callback, Message &response) = nullptr;
+			void (*destroy)(void *callback) = nullptr;
+
+		public:
+
+			/// @brief Error name for calls released before the reply.
+			static constexpr const char *cancelled = "br.eti.werneck.udjat.Error.Cancelled";
+
+			/// @brief The deadline active when the call was sent.
+			Deadline::TimePoint deadline;
+
+			/// @brief Circuit breaker to update with the reply, empty if disabled.
+			std::shared_ptr<CircuitBreaker> breaker;
+
+			/// @brief The destination key on the circuit breaker.
+			const std::string *destination = nullptr;
+
+			/// @brief The call shared with identical ones, empty if not the first.
+			std::shared_ptr<Flights::Flight> flight;
+
+			/// @brief Concurrency limit holding a slot for this call, empty if not throttled.
+			std::shared_ptr<Throttle> throttle;
+
+			/// @brief The destination lane on the concurrency limit.
+			Throttle::Lane *lane = nullptr;
+
+			PendingCall() = default;
+			PendingCall(const PendingCall &) = delete;
+			PendingCall & operator=(const PendingCall &) = delete;
+
+			~PendingCall() {
+				reset();
+			}
+
+			/// @brief Set the method to call with the response.
+			template<typename T>
+			void emplace(T &&callback) {
+
+				typedef typename std::decay<T>::type Functor;
+
+				reset();
+
+				if(sizeof(Functor) <= capacity && alignof(Functor) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible<Functor>::value) {
+
+					new (storage) Functor(std::forward<T>(callback));
+					invoke = [](void *ptr, Message &response) {
+						(*static_cast<Functor *>(ptr))(response);
+					};
+					destroy = [](void *ptr) {
+						static_cast<Functor *>(ptr)->~Functor();
+					};
+
+				} else {
+
+					new (storage) Functor *(new Functor(std::forward<T>(callback)));
+					invoke = [](void *ptr, Message &response) {
+						(**static_cast<Functor **>(ptr))(response);
+					};
+					destroy = [](void *ptr) {
+						delete *static_cast<Functor **>(ptr);
+					};
+
+				}
+
+			}
+
+			inline void operator()(Message &response) {
+				invoke(storage,response);
+			}
+
+			/// @brief Release the callback.
+			void reset() noexcept {
+				if(destroy) {
+					auto method = destroy;
+					invoke = nullptr;
+					destroy = nullptr;
+					method(storage);
+				}
+			}
+
+			struct Statistics {
+				size_t records = 0;		///< @brief Records allocated from the heap.
+				size_t available = 0;	///< @brief Records waiting on the pool.
+				size_t acquired = 0;	///< @brief Records taken from the pool.
+			};
+
+			static Statistics statistics() noexcept;
+
+			/// @brief Get a record from the pool.
+			static PendingCall * acquire();
+
+			/// @brief Enable or disable the pool, when disabled each record is allocated from the heap.
+			/// @details For comparing the heap usage on the unit tests.
+			static void pooling(bool enable) noexcept;
+
+			/// @brief Release the callback and return the record to the pool.
+			static void release(PendingCall *record) noexcept;
+
+			/// @brief Deliver a local error to a call never sent and release the record.
+			static void fail(PendingCall *record, const char *name, const char *message) noexcept;
+
+		};
+
+	}
+
+ }
+
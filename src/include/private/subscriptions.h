@@ -0,0 +1,111 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+ /**
+  * @brief Declares the connection dispatch table.
+  */
+
+ #pragma once
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <udjat/tools/dbus/defs.h>
+ #include <unordered_map>
+ #include <vector>
+ #include <memory>
+
+ namespace Udjat {
+
+	namespace DBus {
+
+		/// @brief Snapshot of the members indexed by (interface, message type, member).
+		/// @details The dispatcher reads the published snapshot without locking. Each interface
+		/// table is immutable and published on its own slot, a change on an interface copies only
+		/// its table; adding or removing an interface builds a new snapshot sharing the slots.
+		class UDJAT_PRIVATE Subscriptions : public std::enable_shared_from_this<Subscriptions> {
+		public:
+
+			/// @brief Case insensitive hash, matching the strcasecmp() used on d-bus names.
+			struct Hash {
+				size_t operator()(const char *name) const noexcept;
+			};
+
+			struct Equal {
+				bool operator()(const char *a, const char *b) const noexcept;
+			};
+
+			struct Key {
+				int type;
+				const char *member;
+			};
+
+			struct KeyHash {
+				size_t operator()(const Key &key) const noexcept;
+			};
+
+			struct KeyEqual {
+				bool operator()(const Key &a, const Key &b) const noexcept;
+			};
+
+			typedef std::vector<std::shared_ptr<const Member>> Members;
+			typedef std::unordered_map<Key,Members,KeyHash,KeyEqual> Table;
+
+		private:
+
+			/// @brief The published table of an interface, replaced with atomic_store.
+			struct Slot {
+				std::shared_ptr<const Table> table;
+			};
+
+			std::unordered_map<const char *,std::shared_ptr<Slot>,Hash,Equal> interfaces;
+
+			/// @brief Build a new snapshot without the interface.
+			std::shared_ptr<const Subscriptions> erase(const char *name) const;
+
+			/// @brief Publish the interface table, remove the interface if it's empty.
+			std::shared_ptr<const Subscriptions> update(const char *name, const std::shared_ptr<Slot> &slot, const std::shared_ptr<const Table> &table) const;
+
+		public:
+
+			/// @brief Add the member, in place if the interface is already there.
+			/// @return The snapshot to publish.
+			std::shared_ptr<const Subscriptions> insert(const Interface &interface, const std::shared_ptr<const Member> &member) const;
+
+			/// @brief Remove the member, in place unless the interface becomes empty.
+			/// @return The snapshot to publish.
+			std::shared_ptr<const Subscriptions> remove(const Interface &interface, const Member &member) const;
+
+			/// @brief Build a new snapshot without the interface.
+			std::shared_ptr<const Subscriptions> remove(const Interface &interface) const;
+
+			inline size_t size() const noexcept {
+				return interfaces.size();
+			}
+
+			/// @brief Get members handling the message.
+			/// @return The member list, empty if there's no subscriber; it keeps the table alive.
+			std::shared_ptr<const Members> find(DBusMessage *message) const noexcept;
+
+		};
+
+	}
+
+ }
+
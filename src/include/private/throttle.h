@@ -0,0 +1,113 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ /**
+  * @brief Declares the per-destination concurrency limit.
+  */
+
+ #pragma once
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <udjat/tools/dbus/defs.h>
+ #include <udjat/tools/dbus/connection.h>
+ #include <udjat/tools/mainloop.h>
+ #include <unordered_map>
+ #include <string>
+ #include <deque>
+ #include <mutex>
+ #include <memory>
+ #include <chrono>
+
+ namespace Udjat {
+
+	namespace DBus {
+
+		/// @brief Limit the calls in flight to each destination.
+		/// @details Calls over the limit wait on a FIFO queue, each reply sends the next one;
+		/// a main loop timer fails the calls whose timeout or deadline expires on the queue.
+		class UDJAT_PRIVATE Throttle : public MainLoop::Timer, public std::enable_shared_from_this<Throttle> {
+		public:
+
+			/// @brief Call waiting for a free slot.
+			struct Queued {
+				DBusConnection *conn = nullptr;
+				DBusMessage *message = nullptr;
+				PendingCall *record = nullptr;
+				int timeout = DBUS_TIMEOUT_USE_DEFAULT;
+				std::chrono::steady_clock::time_point enqueued;
+				std::chrono::steady_clock::time_point expires;
+			};
+
+			/// @brief Slots and queue for one destination.
+			struct Lane {
+				std::string destination;
+				std::deque<Queued> queue;
+				Connection::QueueStatistics statistics;
+			};
+
+		private:
+			std::mutex guard;
+
+			/// @brief Lanes by destination, removed when idle; only the records holding a slot keep pointers to them.
+			std::unordered_map<std::string,Lane> lanes;
+
+			/// @brief Counters from the removed lanes.
+			Connection::QueueStatistics retired;
+
+			/// @brief The expiration the timer is armed for.
+			std::chrono::steady_clock::time_point armed = std::chrono::steady_clock::time_point::max();
+
+			const size_t limit;
+
+			/// @brief Arm the timer for the expiration, from any thread.
+			void arm(const std::chrono::steady_clock::time_point &expires);
+
+		protected:
+
+			/// @brief Fail the expired calls.
+			void on_timer() override;
+
+		public:
+			Throttle(unsigned int limit);
+			virtual ~Throttle();
+
+			Throttle(const Throttle &) = delete;
+			Throttle & operator=(const Throttle &) = delete;
+
+			/// @brief Get a slot for the call.
+			/// @return true if the call can be sent, false if it was queued.
+			bool acquire(DBusConnection *conn, DBusMessage *message, PendingCall *record, int timeout);
+
+			/// @brief Release the slot, or hand it to the next call on the queue.
+			/// @param entry Receives the call to send.
+			/// @return true if there's a call to send.
+			bool next(Lane *lane, Queued &entry) noexcept;
+
+			/// @brief Get the counters for a destination, or the totals.
+			Connection::QueueStatistics statistics(const char *destination) noexcept;
+
+		};
+
+	}
+
+ }
+
@@ -0,0 +1,66 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+ /**
+  * @brief Declares singleton for the d-bus worker pool.
+  */
+
+ #pragma once
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <functional>
+ #include <mutex>
+ #include <condition_variable>
+ #include <deque>
+ #include <thread>
+ #include <vector>
+
+ class UDJAT_PRIVATE WorkerPool {
+ private:
+	std::mutex guard;
+	std::condition_variable wakeup;
+	std::deque<std::function<void()>> tasks;
+	std::vector<std::thread> threads;
+
+	/// @brief Maximum number of worker threads.
+	size_t limit;
+
+	/// @brief Number of idle workers.
+	size_t idle = 0;
+
+	bool running = true;
+
+	WorkerPool();
+
+	void worker();
+
+ public:
+	WorkerPool(const WorkerPool &) = delete;
+	WorkerPool & operator=(const WorkerPool &) = delete;
+
+	~WorkerPool();
+
+	static WorkerPool & getInstance();
+
+	/// @brief Queue task, starts a new worker if the idle ones can't take it.
+	void push(std::function<void()> task);
+
+ };
+
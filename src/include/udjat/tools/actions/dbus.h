@@ -25,6 +25,7 @@
  #include <udjat/tools/request.h>
  #include <udjat/tools/response.h>
  #include <udjat/tools/xml.h>
+ #include <udjat/tools/dbus/introspection.h>
  #include <vector>
 
  namespace Udjat {
@@ -93,6 +94,9 @@
 			/// @brief The alert member.
 			const char *member = nullptr;
 
+			/// @brief Reply timeout in milliseconds ('dbus-timeout' attribute).
+			int timeout = DBUS_TIMEOUT_USE_DEFAULT;
+
 			/// @brief The argument values (can be templates).
 			std::vector<Argument> arguments;
 
@@ -101,6 +105,12 @@
 			/// @return Pointer to D-Bus message.
 			std::shared_ptr<DBusMessage> MessageFactory(const std::vector<String> &vals);
 
+			/// @brief Construct D-Bus message using the argument types from introspection.
+			/// @param vals The argument values.
+			/// @param method The method description, nullptr to use the declared types.
+			/// @return Pointer to D-Bus message.
+			std::shared_ptr<DBusMessage> MessageFactory(const std::vector<String> &vals, const Introspection::Method *method);
+
 		};
  	}
  
@@ -26,10 +26,19 @@
  #include <dbus/dbus.h>
  #include <udjat/defs.h>
  #include <udjat/tools/dbus/defs.h>
+ #include <udjat/tools/dbus/member.h>
+ #include <udjat/tools/dbus/reply.h>
+ #include <udjat/tools/dbus/deadline.h>
+ #include <udjat/tools/dbus/introspection.h>
+ #include <udjat/tools/dbus/message.h>
  #include <string>
  #include <mutex>
  #include <thread>
+ #include <atomic>
  #include <list>
+ #include <vector>
+ #include <memory>
+ #include <functional>
  #include <udjat/tools/xml.h>
 
  namespace Udjat {
@@ -51,22 +60,104 @@
 			/// @brief Service thread.
 			std::thread * thread = nullptr;
 
+			/// @brief True while the service thread should keep running.
+			std::atomic<bool> running{false};
+
+			/// @brief Service thread main loop (defined in thread.cc).
+			void run() noexcept;
+
+			/// @brief Callbacks waiting for the main loop (defined in thread.cc).
+			class Marshal;
+			std::shared_ptr<Marshal> marshal;
+
+			/// @brief Service thread socket, timeouts and wake up (defined in thread.cc).
+			class Loop;
+			std::shared_ptr<Loop> loop;
+
+			/// @brief Deliver incoming message to the member, on the main loop if requested.
+			void dispatch(const std::shared_ptr<const Member> &member, const std::shared_ptr<const Arguments> &arguments);
+
 			/// @brief Message filter method.
 			static DBusHandlerResult on_message(DBusConnection *, DBusMessage *, Connection *) noexcept;
 
+			friend class Interface;
+
 			/// @brief Interfaces in this connection.
 			std::list<Interface> interfaces;
 
-			void insert(const Interface &interface);
-			void remove(const Interface &interface);
+			/// @brief Members indexed for dispatch (immutable, replaced on every change).
+			std::shared_ptr<const Subscriptions> subscriptions;
+
+			/// @brief Get the current dispatch table.
+			std::shared_ptr<const Subscriptions> snapshot() const noexcept;
+
+			/// @brief Replace the dispatch table, requires the guard.
+			void publish(std::shared_ptr<const Subscriptions> table) noexcept;
+
+			/// @brief Match rules waiting to be sent (defined in match.cc).
+			class Rules;
+			std::shared_ptr<Rules> rules;
+
+			/// @brief Queue match rule for the next batch, requires the guard.
+			void add_match(const char *rule);
+
+			/// @brief Remove match rule, requires the guard.
+			void remove_match(const char *rule);
+
+			/// @brief Add member to the dispatch table, requires the guard.
+			void index(const Interface &interface, const std::shared_ptr<const Member> &member);
+
+			/// @brief Remove member from the dispatch table, requires the guard.
+			void unindex(const Interface &interface, const Member &member);
+
+			/// @brief Send method call, the record is released with the pending call (defined in call.cc).
+			void send(DBusMessage * message, PendingCall *record, int timeout);
+
+			/// @brief Send each request through send(), with a single flush (defined in batch.cc).
+			/// @param reply Method called for each response, with the request index.
+			void send(const std::vector<DBusMessage *> &requests, const std::function<void(size_t index, Message & response)> &reply, int timeout);
+
+			/// @brief Fail before sending file descriptors to a peer that can't receive them (defined in call.cc).
+			void check_fds(DBusMessage * message) const;
+
+			/// @brief Client-side property cache, empty if disabled (defined in properties.cc).
+			class Properties;
+			std::shared_ptr<Properties> properties;
+
+			/// @brief Get property from the cache, if enabled.
+			/// @return false if the cache is disabled.
+			bool get_cached(const char *destination, const char *path, const char *interface, const char *property_name, const std::function<void(Message & message)> &call, int timeout);
+
+			/// @brief Name owner registry (defined in names.cc), loaded on first use.
+			class Names;
+			std::shared_ptr<Names> names;
+
+			/// @brief Create an empty name owner registry.
+			static std::shared_ptr<Names> NamesFactory(Connection &connection);
+
+			/// @brief Get the name owner registry, load it on first use.
+			std::shared_ptr<Names> registry() const;
+
+			/// @brief Introspection cache (defined in introspection.cc).
+			class Introspections;
+			std::shared_ptr<Introspections> introspections;
+
+			/// @brief Per-destination circuit breaker, empty if disabled.
+			std::shared_ptr<CircuitBreaker> breaker;
+
+			/// @brief Identical calls in flight, empty if disabled (defined in flights.cc).
+			std::shared_ptr<Flights> flights;
+
+			/// @brief Per-destination limit of calls in flight, empty if disabled (defined in throttle.cc).
+			std::shared_ptr<Throttle> throttle;
 
 		protected:
 
 			/// @brief Connection to D-Bus.
 			DBusConnection * conn = nullptr;
 
-			/// @brief Mutex for serialization.
-			static std::mutex guard;
+			/// @brief Mutex for serialization of changes on this connection.
+			mutable std::mutex guard;
 
 			Connection(const char *name, DBusConnection * conn);
 
@@ -101,8 +192,26 @@
 				return object_name.c_str();
 			}
 
+			/// @brief Check if the name has an owner.
+			/// @details Answered from memory, the names are loaded on the first use
+			/// and kept up to date by NameOwnerChanged.
 			bool name_has_owner(const char *name) const;
 
+			/// @brief Get the unique name owning the name.
+			/// @return The owner, empty if there's none.
+			std::string name_owner(const char *name) const;
+
+			/// @brief Method called when a name owner changes, with the new owner (empty if released).
+			typedef std::function<void(const char *name, const char *owner)> NameOwnerCallback;
+
+			/// @brief Watch owner changes.
+			/// @param name The name to watch, nullptr for all.
+			/// @return Watcher id, for unwatch_name().
+			size_t watch_name(const char *name, const NameOwnerCallback &callback);
+
+			/// @brief Remove owner watcher.
+			void unwatch_name(size_t id);
+
 			inline DBusConnection * connection() const noexcept {
 				return conn;
 			}
@@ -119,6 +228,48 @@
 
 			void flush() noexcept;
 
+			/// @brief Dispatch counters.
+			struct Statistics {
+				size_t wakeups = 0;		///< @brief Number of dispatch runs.
+				size_t messages = 0;	///< @brief Number of dispatched messages.
+				size_t exhausted = 0;	///< @brief Number of runs stopped by the budget.
+				size_t coalesced = 0;	///< @brief Number of wake-up requests merged with a pending one.
+			};
+
+			/// @brief Get the dispatch counters for this connection.
+			Statistics statistics() const noexcept;
+
+			/// @brief Set the maximum number of messages dispatched on each main loop pass.
+			/// @details The remaining messages are dispatched on the next pass, so a busy
+			/// bus can't starve the other connections and handlers.
+			/// @param messages The number of messages, 0 for unlimited.
+			void dispatch_budget(size_t messages) noexcept;
+
+			/// @brief Read and dispatch messages on a dedicated thread, instead of the main loop.
+			/// @details The connection timeouts (including the method call replies) run on the same thread.
+			/// @param mainloop If true the member callbacks are called from the main loop, not from the service thread;
+			/// the replies to method calls (call, call_async, call_batch) are always delivered on the service thread.
+			void start(bool mainloop = false);
+
+			/// @brief Stop the service thread, go back to the main loop.
+			/// @details When called from the service thread (from a callback) it returns
+			/// immediately, the thread is joined on the main loop.
+			void stop();
+
+			/// @brief Is the connection using a service thread?
+			inline bool threaded() const noexcept {
+				return thread != nullptr;
+			}
+
+			/// @brief Send the queued match rules now, with a single flush.
+			/// @details Match rules are queued and sent in batches from the main loop,
+			/// use this method to register them immediately.
+			void commit();
+
+			/// @brief Set the method to call when the bus rejects a match rule.
+			/// @param callback The method receiving the rule and the error message.
+			void on_match_error(const std::function<void(const char *rule, const char *message)> &callback);
+
 			void push_back(Interface &interface);
 			void remove(Interface &interface);
 			
@@ -151,6 +302,16 @@
 			/// @return Member handling the signal.
 			Member & subscribe(const char *interface, const char *member, const std::function<bool(Message &message)> &callback);
 
+			/// @brief Subscribe to d-bus signal.
+			/// @param mode Member::Pooled to run the callback from the worker pool.
+			/// @return Member handling the signal.
+			Member & subscribe(const char *interface, const char *member, const std::function<bool(Message &message)> &callback, const Member::Mode mode);
+
+			/// @brief Subscribe to d-bus signal with extra constraints.
+			/// @param match The required sender, path, path namespace or string arguments.
+			/// @return Member handling the signal.
+			Member & subscribe(const char *interface, const char *member, const Member::Match &match, const std::function<bool(Message &message)> &callback, const Member::Mode mode = Member::Inline);
+
 			/// @brief Watch d-bus method calls.
 			/// @return Member handling the signal.
 			Member & watch(const char *interface, const char *member, const std::function<bool(Message &message)> &callback);
@@ -161,12 +322,55 @@
 			/// @brief Call method
 			void call(DBusMessage * message, const std::function<void(Message & message)> &call);
 
+			/// @brief Call method
+			/// @param timeout Reply timeout in milliseconds, limited by the active DBus::Deadline.
+			void call(DBusMessage * message, const std::function<void(Message & message)> &call, int timeout);
+
 			/// @brief Call method (syncronous);
 			void call(DBusMessage * message);
 
+			/// @brief Call method (syncronous);
+			/// @param timeout Reply timeout in milliseconds, limited by the active DBus::Deadline.
+			void call(DBusMessage * message, int timeout);
+
+			/// @brief Method for call_batch().
+			struct Method {
+				const char *destination;
+				const char *path;
+				const char *interface;
+				const char *member;
+			};
+
+			/// @brief Send all requests with a single flush (async).
+			/// @param call Method called for each response, with the request index.
+			void call_batch(const std::vector<DBusMessage *> &requests, const std::function<void(size_t index, Message & response)> &call, int timeout = DBUS_TIMEOUT_USE_DEFAULT);
+
+			/// @brief Send all requests with a single flush (async).
+			/// @param call Method called when all the responses are available, in request order.
+			void call_batch(const std::vector<DBusMessage *> &requests, const std::function<void(std::vector<std::shared_ptr<Message>> & responses)> &call, int timeout = DBUS_TIMEOUT_USE_DEFAULT);
+
+			/// @brief Send all method calls with a single flush (async).
+			void call_batch(const std::vector<Method> &methods, const std::function<void(size_t index, Message & response)> &call, int timeout = DBUS_TIMEOUT_USE_DEFAULT);
+
+			/// @brief Send all method calls with a single flush (async).
+			void call_batch(const std::vector<Method> &methods, const std::function<void(std::vector<std::shared_ptr<Message>> & responses)> &call, int timeout = DBUS_TIMEOUT_USE_DEFAULT);
+
+			/// @brief Call method (async), get the reply as a future or awaitable.
+			Reply call_async(DBusMessage * message, int timeout = DBUS_TIMEOUT_USE_DEFAULT);
+
+			/// @brief Call method (async), get the reply as a future or awaitable.
+			Reply call_async(const Message & request, int timeout = DBUS_TIMEOUT_USE_DEFAULT);
+
+			/// @brief Call method (async), get the reply as a future or awaitable.
+			Reply call_async(const char *destination, const char *path, const char *interface, const char *member, int timeout = DBUS_TIMEOUT_USE_DEFAULT);
+
 			/// @brief Call method (syncronous);
 			void call_and_wait(DBusMessage * message, const std::function<void(Message & message)> &call);
 
+			/// @brief Call method (syncronous);
+			/// @param timeout Reply timeout in milliseconds, limited by the active DBus::Deadline.
+			void call_and_wait(DBusMessage * message, const std::function<void(Message & message)> &call, int timeout);
+
 			/// @brief Call method (async)
 			void call(	const char *destination,
 						const char *path,
@@ -175,11 +379,28 @@
 						const std::function<void(Message & message)> &call
 					);
 
+			/// @brief Call method (async)
+			/// @param timeout Reply timeout in milliseconds, limited by the active DBus::Deadline.
+			void call(	const char *destination,
+						const char *path,
+						const char *interface,
+						const char *member,
+						const std::function<void(Message & message)> &call,
+						int timeout
+					);
+
 			/// @brief Call method (async)
 			void call(	const Message & request,
 						const std::function<void(Message & response)> &call
 					);
 
+			/// @brief Call method (async)
+			/// @param timeout Reply timeout in milliseconds, limited by the active DBus::Deadline.
+			void call(	const Message & request,
+						const std::function<void(Message & response)> &call,
+						int timeout
+					);
+
 			/// @brief Call method (sync)
 			void call_and_wait(	const char *destination,
 								const char *path,
@@ -188,11 +409,127 @@
 								const std::function<void(Message & message)> &call
 					);
 
+			/// @brief Call method (sync)
+			/// @param timeout Reply timeout in milliseconds, limited by the active DBus::Deadline.
+			void call_and_wait(	const char *destination,
+								const char *path,
+								const char *interface,
+								const char *member,
+								const std::function<void(Message & message)> &call,
+								int timeout
+					);
+
 			void call_and_wait(	const Message & request,
 								const std::function<void(Message & response)> &call
 					);
 
+			void call_and_wait(	const Message & request,
+								const std::function<void(Message & response)> &call,
+								int timeout
+					);
+
+			/// @brief Call method and decode the reply (syncronous).
+			/// @details The reply signature is checked once against DBus::Results<R>, the values
+			/// are decoded without type dispatch; the timeout is the one from DBus::Deadline.
+			/// @tparam R The reply type, std::tuple for replies with more than one value.
+			/// @return The decoded reply.
+			template <typename R, typename... Targs>
+			R call(const char *destination, const char *path, const char *interface, const char *member, const Targs &... args) {
+
+				Message request{destination,path,interface,member};
+				(request.push_back(args), ...);
+
+				R result{};
+				call_and_wait(request,[&result](Message &response){
+					response.except();
+					Results<R>::pop(response,result);
+				});
+
+				return result;
+
+			}
+
+			/// @brief Fail calls to unresponsive destinations immediately.
+			/// @details After a number of consecutive ServiceUnknown/NoReply errors the calls
+			/// to the destination fail with ServiceUnknown without touching the bus; one call
+			/// is sent as a probe after each interval. The circuit closes when the destination
+			/// answers or gets a new owner.
+			/// @param failures Consecutive failures to open the circuit, 0 to disable.
+			/// @param interval Milliseconds between probes while the circuit is open.
+			void circuit_breaker(unsigned int failures = 5, unsigned int interval = 5000);
+
+			/// @brief Check if values of the type can be sent to the peer.
+			/// @param type The d-bus type, usually DBUS_TYPE_UNIX_FD.
+			bool can_send_type(int type) const noexcept;
+
+			/// @brief Share the reply of identical asynchronous calls.
+			/// @details A method call with the same destination, path, interface, member and
+			/// arguments of an outstanding one isn't sent, it gets the reply of the first one.
+			/// Only the calls sent while a SingleFlight is active are shared, the message
+			/// bus itself is never shared.
+			/// @param enable false to send every call.
+			void single_flight(bool enable = true);
+
+			/// @brief Share the reply of the asynchronous calls sent while it is active.
+			/// @details Per thread, only for idempotent methods: the service sees a single call.
+			class UDJAT_API SingleFlight {
+			public:
+				SingleFlight();
+				~SingleFlight();
+
+				SingleFlight(const SingleFlight &) = delete;
+				SingleFlight & operator=(const SingleFlight &) = delete;
+
+				/// @brief Check if the calls from this thread can be shared.
+				static bool active() noexcept;
+			};
+
+			struct FlightStatistics {
+				size_t sent = 0;	///< @brief Calls sent to the bus.
+				size_t joined = 0;	///< @brief Calls answered with the reply of another one.
+			};
+
+			/// @brief Get single-flight counters, since it was enabled.
+			FlightStatistics single_flight_statistics() const noexcept;
+
+			/// @brief Limit the asynchronous calls in flight to each destination, call_batch() requests included.
+			/// @details Calls over the limit wait, in order, for the reply of an earlier one;
+			/// the time on the queue counts against their timeout.
+			/// @param limit Maximum number of calls in flight per destination, 0 to disable.
+			void max_in_flight(unsigned int limit);
+
+			struct QueueStatistics {
+				size_t in_flight = 0;	///< @brief Calls waiting for the reply.
+				size_t max_in_flight = 0;	///< @brief Highest number of calls waiting for the reply.
+				size_t queued = 0;		///< @brief Calls waiting for a slot.
+				size_t max_queued = 0;	///< @brief Highest queue depth.
+				size_t delayed = 0;		///< @brief Calls sent after waiting on the queue.
+				size_t expired = 0;		///< @brief Calls failed on the queue, by timeout or deadline.
+				std::chrono::microseconds wait{0};		///< @brief Total time on the queue.
+				std::chrono::microseconds max_wait{0};	///< @brief Longest time on the queue.
+			};
+
+			/// @brief Get the queue counters, since the limit was set.
+			/// @param destination The destination, nullptr for the totals.
+			QueueStatistics queue_statistics(const char *destination = nullptr) const noexcept;
+
+			/// @brief Get the introspection data for an object (syncronous).
+			/// @details The data is cached until the destination owner changes. An error reply is cached
+			/// too, as an object without interfaces; only the first call throws it.
+			/// @param timeout Reply timeout in milliseconds, limited by the active DBus::Deadline.
+			std::shared_ptr<const Introspection> introspect(const char *destination, const char *path, int timeout = DBUS_TIMEOUT_USE_DEFAULT);
+
+			/// @brief Enable the client-side property cache for get().
+			/// @details Each (destination, path, interface) is loaded with GetAll on the first read
+			/// and kept up to date by PropertiesChanged; it's reloaded when the destination owner
+			/// changes. Properties not announced by PropertiesChanged can get stale, keep it disabled
+			/// for services that don't emit it.
+			/// @param enable false to disable and drop the cache.
+			void property_cache(bool enable = true);
+
 			/// @brief Get property.
+			/// @details Answered from memory when the property cache is enabled; the callback
+			/// is still called from the main loop, never from inside get().
 			/// @param name	Property name.
 			void get(	const char *destination,
 						const char *path,
@@ -201,6 +538,17 @@
 						const std::function<void(Message & message)> &call
 					);
 
+			/// @brief Get property.
+			/// @param name	Property name.
+			/// @param timeout Reply timeout in milliseconds, limited by the active DBus::Deadline.
+			void get(	const char *destination,
+						const char *path,
+						const char *interface,
+						const char *property_name,
+						const std::function<void(Message & message)> &call,
+						int timeout
+					);
+
 		};
 
 		/// @brief System bus connection.
@@ -0,0 +1,85 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+ /**
+  * @brief Declare D-Bus call deadline.
+  */
+
+ #pragma once
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <chrono>
+
+ namespace Udjat {
+
+ 	namespace DBus {
+
+		/// @brief Overall time budget for the d-bus calls made while it is active.
+		/// @details Deadlines are per thread and nest, an inner deadline can't extend
+		/// the outer one. Asynchronous calls keep the deadline active when they are
+		/// sent and restore it while running the reply callback, so nested calls share
+		/// the same budget.
+		class UDJAT_API Deadline {
+		public:
+			typedef std::chrono::steady_clock::time_point TimePoint;
+
+			/// @brief The libdbus default timeout, in milliseconds.
+			static constexpr int default_timeout = 25000;
+
+		private:
+			TimePoint value;
+			Deadline *parent;
+
+		public:
+
+			/// @brief Activate deadline relative to now.
+			/// @param milliseconds The time budget.
+			Deadline(int milliseconds);
+
+			/// @brief Activate absolute deadline.
+			/// @param limit The deadline, TimePoint::max() for none.
+			Deadline(const TimePoint &limit);
+
+			~Deadline();
+
+			Deadline(const Deadline &) = delete;
+			Deadline & operator=(const Deadline &) = delete;
+
+			/// @brief Get the active deadline for this thread.
+			/// @return The deadline, TimePoint::max() if there's none.
+			static TimePoint limit() noexcept;
+
+			/// @brief Get the remaining time in milliseconds, 0 if expired.
+			int remaining() const noexcept;
+
+			inline bool expired() const noexcept {
+				return remaining() == 0;
+			}
+
+			/// @brief Get the timeout for a d-bus call, limited by the active deadline.
+			/// @param milliseconds The requested timeout or DBUS_TIMEOUT_USE_DEFAULT.
+			/// @return The timeout to use on libdbus.
+			/// @exception std::system_error ETIMEDOUT if the active deadline has expired.
+			static int timeout(int milliseconds = DBUS_TIMEOUT_USE_DEFAULT);
+
+		};
+
+ 	}
+
+ }
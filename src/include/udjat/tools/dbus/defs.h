@@ -35,6 +35,14 @@
 		class Interface;
 		class Signal;
 		class Member;
+		class Connection;
+		class Subscriptions;
+		class Arguments;
+		class PendingCall;
+		class Introspection;
+		class CircuitBreaker;
+		class Flights;
+		class Throttle;
 
  	}
 
@@ -25,9 +25,13 @@
  #include <udjat/defs.h>
  #include <string>
  #include <udjat/tools/xml.h>
+ #include <udjat/tools/dbus/defs.h>
  #include <udjat/tools/dbus/member.h>
  #include <list>
+ #include <memory>
  #include <functional>
+ #include <iterator>
+ #include <cstddef>
 
  namespace Udjat {
 
@@ -67,7 +71,16 @@
 
 		class UDJAT_API Interface : public Abstract::DBus::Interface {
 		private:
-			std::list<Udjat::DBus::Member> members;
+			friend class Connection;
+			friend class Subscriptions;
+
+			/// @brief The connection dispatching this interface, nullptr if not attached.
+			Connection *connection = nullptr;
+
+			/// @brief Members, shared with the dispatch snapshots.
+			std::list<std::shared_ptr<Udjat::DBus::Member>> members;
+
+			Udjat::DBus::Member & insert(std::shared_ptr<Udjat::DBus::Member> member);
 
 		public:
 
@@ -86,27 +99,75 @@
 			}
 
 			Udjat::DBus::Member & push_back(const XML::Node &node,const std::function<bool(Message & message)> &callback);
-			Udjat::DBus::Member & emplace_back(const char *member, const std::function<bool(Message & message)> &callback);
+			Udjat::DBus::Member & emplace_back(const char *member, const std::function<bool(Message & message)> &callback, const Udjat::DBus::Member::Mode mode = Udjat::DBus::Member::Inline);
+
+			/// @brief Add member accepting only messages with the required sender, path or arguments.
+			Udjat::DBus::Member & emplace_back(const char *member, const Udjat::DBus::Member::Match &match, const std::function<bool(Message & message)> &callback, const Udjat::DBus::Member::Mode mode = Udjat::DBus::Member::Inline);
 
 			void remove(const Udjat::DBus::Member &member);
 
-#if __cplusplus >= 201703
-			inline auto begin() const noexcept {
-				return members.begin();
-			}
+			/// @brief Iterator over the members, yields the member as before they were shared.
+			class const_iterator {
+			private:
+				std::list<std::shared_ptr<Udjat::DBus::Member>>::const_iterator it;
 
-			inline auto end() const noexcept {
-				return members.end();
-			}
-#else
-			inline std::list<Udjat::DBus::Member>::const_iterator begin() const noexcept {
-				return members.begin();
+			public:
+				typedef std::bidirectional_iterator_tag iterator_category;
+				typedef const Udjat::DBus::Member value_type;
+				typedef std::ptrdiff_t difference_type;
+				typedef const Udjat::DBus::Member * pointer;
+				typedef const Udjat::DBus::Member & reference;
+
+				const_iterator(const std::list<std::shared_ptr<Udjat::DBus::Member>>::const_iterator &i) : it{i} {
+				}
+
+				inline reference operator*() const noexcept {
+					return **it;
+				}
+
+				inline pointer operator->() const noexcept {
+					return it->get();
+				}
+
+				inline const_iterator & operator++() noexcept {
+					++it;
+					return *this;
+				}
+
+				inline const_iterator operator++(int) noexcept {
+					const_iterator rc{*this};
+					++it;
+					return rc;
+				}
+
+				inline const_iterator & operator--() noexcept {
+					--it;
+					return *this;
+				}
+
+				inline const_iterator operator--(int) noexcept {
+					const_iterator rc{*this};
+					--it;
+					return rc;
+				}
+
+				inline bool operator==(const const_iterator &other) const noexcept {
+					return it == other.it;
+				}
+
+				inline bool operator!=(const const_iterator &other) const noexcept {
+					return it != other.it;
+				}
+
+			};
+
+			inline const_iterator begin() const noexcept {
+				return const_iterator{members.begin()};
 			}
 
-			inline std::list<Udjat::DBus::Member>::const_iterator end() const noexcept {
-				return members.end();
+			inline const_iterator end() const noexcept {
+				return const_iterator{members.end()};
 			}
-#endif
 
 		};
 
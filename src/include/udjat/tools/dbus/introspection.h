@@ -0,0 +1,92 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+ /**
+  * @brief Declare D-Bus introspection data.
+  */
+
+ #pragma once
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <udjat/tools/dbus/defs.h>
+ #include <string>
+ #include <vector>
+ #include <unordered_map>
+
+ namespace Udjat {
+
+ 	namespace DBus {
+
+		/// @brief Compact method and property table parsed from org.freedesktop.DBus.Introspectable.
+		class UDJAT_API Introspection {
+		public:
+
+			/// @brief Method argument.
+			struct Argument {
+				std::string name;		///< @brief Argument name (can be empty).
+				std::string signature;	///< @brief Argument signature.
+
+				/// @brief Get the d-bus type code.
+				inline int type() const noexcept {
+					return signature.empty() ? DBUS_TYPE_INVALID : (int) signature[0];
+				}
+			};
+
+			struct Method {
+				std::vector<Argument> input;
+				std::vector<Argument> output;
+			};
+
+			struct Property {
+				std::string signature;
+				bool readable = true;
+				bool writable = false;
+			};
+
+			struct Interface {
+				std::unordered_map<std::string,Method> methods;
+				std::unordered_map<std::string,Property> properties;
+			};
+
+		private:
+			std::unordered_map<std::string,Interface> interfaces;
+
+		public:
+
+			/// @brief Parse introspection data.
+			/// @param xml The response from Introspect().
+			Introspection(const char *xml);
+
+			/// @brief Find method.
+			/// @return The method description, nullptr if not found.
+			const Method * method(const char *interface, const char *name) const noexcept;
+
+			/// @brief Find property.
+			/// @return The property description, nullptr if not found.
+			const Property * property(const char *interface, const char *name) const noexcept;
+
+			inline size_t size() const noexcept {
+				return interfaces.size();
+			}
+
+		};
+
+ 	}
+
+ }
@@ -0,0 +1,535 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ /**
+  * @brief Declares the compile-time typed marshalling.
+  * @details Each marshallable type has a DBus::Type<T> specialization with the d-bus
+  * signature as a constexpr string and the methods to append/read it; user structs
+  * can be declared with DBus::Fields:
+  *
+  * @code
+  * struct Point { int32_t x; int32_t y; };
+  * template <> struct Udjat::DBus::Type<Point> : Udjat::DBus::Fields<Point,&Point::x,&Point::y> {};
+  * @endcode
+  */
+
+ #pragma once
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <cstddef>
+ #include <cstdint>
+ #include <string>
+ #include <vector>
+ #include <map>
+ #include <tuple>
+ #include <optional>
+ #include <utility>
+ #include <type_traits>
+ #include <stdexcept>
+
+ namespace Udjat {
+
+	namespace DBus {
+
+		/// @brief D-Bus type signature, built at compile time.
+		template <size_t N>
+		struct Signature {
+
+			char value[N+1];
+
+			static constexpr size_t size() noexcept {
+				return N;
+			}
+
+			constexpr const char * c_str() const noexcept {
+				return value;
+			}
+
+			template <size_t M>
+			constexpr Signature<N+M> operator+(const Signature<M> &other) const noexcept {
+				Signature<N+M> result{};
+				for(size_t ix = 0; ix < N; ix++) {
+					result.value[ix] = value[ix];
+				}
+				for(size_t ix = 0; ix < M; ix++) {
+					result.value[N+ix] = other.value[ix];
+				}
+				result.value[N+M] = 0;
+				return result;
+			}
+
+		};
+
+		/// @brief Build signature from a string literal.
+		template <size_t N>
+		constexpr Signature<N-1> make_signature(const char (&str)[N]) noexcept {
+			Signature<N-1> result{};
+			for(size_t ix = 0; ix < N; ix++) {
+				result.value[ix] = str[ix];
+			}
+			return result;
+		}
+
+		/// @brief Marshalling traits, specialized for every supported type.
+		template <typename T, typename Enable = void>
+		struct Type;
+
+		/// @brief Check if there's a DBus::Type<T> specialization.
+		template <typename T, typename Enable = void>
+		struct is_marshallable : std::false_type {
+		};
+
+		template <typename T>
+		struct is_marshallable<T, std::void_t<decltype(Type<T>::signature)>> : std::true_type {
+		};
+
+		/// @brief Check if the push_back() template can add T.
+		/// @details Integral types narrower than int are left to the non template overloads,
+		/// they were always sent as int (INT16/UINT16 on Signal) and keep the signature.
+		template <typename T>
+		struct is_appendable : std::integral_constant<bool,is_marshallable<T>::value && !(std::is_integral<T>::value && sizeof(T) < sizeof(int))> {
+		};
+
+		/// @brief Check if the pop() template can read T.
+		/// @details Classes derived from std::string are left to pop(std::string &), it also
+		/// accepts object paths, signatures and strings inside variants.
+		template <typename T>
+		struct is_poppable : std::integral_constant<bool,is_marshallable<T>::value && !(std::is_base_of<std::string,T>::value && !std::is_same<std::string,T>::value)> {
+		};
+
+		/// @brief Check if arrays of T can be read and written in one block.
+		template <typename T, typename Enable = void>
+		struct is_fixed : std::false_type {
+		};
+
+		template <typename T>
+		struct is_fixed<T, typename std::enable_if<Type<T>::fixed>::type> : std::true_type {
+		};
+
+		/// @brief Throw if the argument at the iterator doesn't have the expected signature.
+		UDJAT_API void check_signature(DBusMessageIter *iter, const char *expected);
+
+		/// @brief Throw if the message arguments don't have the expected signature.
+		UDJAT_API void check_signature(DBusMessage *message, const char *expected);
+
+		/// @brief Basic d-bus types.
+		/// @tparam code The d-bus type code.
+		/// @tparam T The C++ type.
+		/// @tparam D The libdbus type.
+		template <int code, typename T, typename D>
+		struct Basic {
+
+			static constexpr Signature<1> signature{{(char) code, 0}};
+
+			static constexpr int type = code;
+
+			/// @brief True if arrays of T can be read and written in one block.
+			static constexpr bool fixed = std::is_same<T,D>::value;
+
+			static void push(DBusMessageIter *iter, const T &value) {
+				D dval = (D) value;
+				if(!dbus_message_iter_append_basic(iter,code,&dval)) {
+					throw std::runtime_error("Can't add value to d-bus iterator");
+				}
+			}
+
+			static void pop(DBusMessageIter *iter, T &value) {
+				D dval;
+				dbus_message_iter_get_basic(iter,&dval);
+				value = (T) dval;
+				dbus_message_iter_next(iter);
+			}
+
+		};
+
+		template <>
+		struct Type<bool> : Basic<DBUS_TYPE_BOOLEAN,bool,dbus_bool_t> {
+		};
+
+		template <>
+		struct Type<uint8_t> : Basic<DBUS_TYPE_BYTE,uint8_t,unsigned char> {
+		};
+
+		template <>
+		struct Type<int16_t> : Basic<DBUS_TYPE_INT16,int16_t,dbus_int16_t> {
+		};
+
+		template <>
+		struct Type<uint16_t> : Basic<DBUS_TYPE_UINT16,uint16_t,dbus_uint16_t> {
+		};
+
+		template <>
+		struct Type<int32_t> : Basic<DBUS_TYPE_INT32,int32_t,dbus_int32_t> {
+		};
+
+		template <>
+		struct Type<uint32_t> : Basic<DBUS_TYPE_UINT32,uint32_t,dbus_uint32_t> {
+		};
+
+		template <>
+		struct Type<int64_t> : Basic<DBUS_TYPE_INT64,int64_t,dbus_int64_t> {
+		};
+
+		template <>
+		struct Type<uint64_t> : Basic<DBUS_TYPE_UINT64,uint64_t,dbus_uint64_t> {
+		};
+
+		template <>
+		struct Type<double> : Basic<DBUS_TYPE_DOUBLE,double,double> {
+		};
+
+		/// @brief Strings, including the ones derived from std::string.
+		template <typename T>
+		struct Type<T, typename std::enable_if<std::is_base_of<std::string,T>::value>::type> {
+
+			static constexpr Signature<1> signature{{(char) DBUS_TYPE_STRING, 0}};
+
+			static constexpr int type = DBUS_TYPE_STRING;
+
+			static void push(DBusMessageIter *iter, const T &value) {
+				const char *str = value.c_str();
+				if(!dbus_message_iter_append_basic(iter,DBUS_TYPE_STRING,&str)) {
+					throw std::runtime_error("Can't add value to d-bus iterator");
+				}
+			}
+
+			static void pop(DBusMessageIter *iter, T &value) {
+				const char *str = nullptr;
+				dbus_message_iter_get_basic(iter,&str);
+				value.assign(str);
+				dbus_message_iter_next(iter);
+			}
+
+		};
+
+		/// @brief Open container, throw on failure.
+		inline void open_container(DBusMessageIter *iter, int type, const char *signature, DBusMessageIter *sub) {
+			if(!dbus_message_iter_open_container(iter,type,signature,sub)) {
+				throw std::runtime_error("Can't open d-bus container");
+			}
+		}
+
+		/// @brief Close container, throw on failure.
+		inline void close_container(DBusMessageIter *iter, DBusMessageIter *sub) {
+			if(!dbus_message_iter_close_container(iter,sub)) {
+				throw std::runtime_error("Can't close d-bus container");
+			}
+		}
+
+		/// @brief Arrays, 'a' + element; fixed size elements are copied in one block.
+		template <typename T>
+		struct Type<std::vector<T>> {
+
+			static constexpr auto signature = make_signature("a") + Type<T>::signature;
+
+			static void push(DBusMessageIter *iter, const std::vector<T> &value) {
+
+				DBusMessageIter sub;
+				open_container(iter,DBUS_TYPE_ARRAY,Type<T>::signature.c_str(),&sub);
+
+				if constexpr (is_fixed<T>::value) {
+					const T *elements = value.data();
+					if(!dbus_message_iter_append_fixed_array(&sub,Type<T>::type,&elements,(int) value.size())) {
+						dbus_message_iter_abandon_container(iter,&sub);
+						throw std::runtime_error("Can't add array to d-bus iterator");
+					}
+				} else {
+					for(const auto &element : value) {
+						Type<T>::push(&sub,element);
+					}
+				}
+
+				close_container(iter,&sub);
+
+			}
+
+			static void pop(DBusMessageIter *iter, std::vector<T> &value) {
+
+				DBusMessageIter sub;
+				dbus_message_iter_recurse(iter,&sub);
+
+				value.clear();
+
+				if constexpr (is_fixed<T>::value) {
+					const T *elements = nullptr;
+					int length = 0;
+					dbus_message_iter_get_fixed_array(&sub,&elements,&length);
+					value.assign(elements,elements+length);
+				} else {
+					while(dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_INVALID) {
+						T element{};
+						Type<T>::pop(&sub,element);
+						value.push_back(std::move(element));
+					}
+				}
+
+				dbus_message_iter_next(iter);
+
+			}
+
+		};
+
+		/// @brief View of an array of fixed size elements.
+		/// @details Read from a message it points to the message buffer and is valid while
+		/// the message is alive; written to a message the elements are copied once.
+		template <typename T>
+		class Span {
+		private:
+			const T *elements = nullptr;
+			size_t length = 0;
+
+		public:
+			constexpr Span() noexcept = default;
+
+			constexpr Span(const T *e, size_t l) noexcept : elements{e}, length{l} {
+			}
+
+			Span(const std::vector<T> &values) noexcept : elements{values.data()}, length{values.size()} {
+			}
+
+			constexpr const T * data() const noexcept {
+				return elements;
+			}
+
+			constexpr size_t size() const noexcept {
+				return length;
+			}
+
+			constexpr bool empty() const noexcept {
+				return length == 0;
+			}
+
+			constexpr const T * begin() const noexcept {
+				return elements;
+			}
+
+			constexpr const T * end() const noexcept {
+				return elements+length;
+			}
+
+			constexpr const T & operator[](size_t index) const noexcept {
+				return elements[index];
+			}
+
+		};
+
+		/// @brief Arrays of fixed size elements, without copies on read ('ay', 'ai', 'ad', ...).
+		template <typename T>
+		struct Type<Span<T>> {
+
+			static_assert(is_fixed<T>::value,"Span requires fixed size elements with the d-bus layout");
+
+			static constexpr auto signature = make_signature("a") + Type<T>::signature;
+
+			static void push(DBusMessageIter *iter, const Span<T> &value) {
+
+				DBusMessageIter sub;
+				open_container(iter,DBUS_TYPE_ARRAY,Type<T>::signature.c_str(),&sub);
+
+				const T *elements = value.data();
+				if(!dbus_message_iter_append_fixed_array(&sub,Type<T>::type,&elements,(int) value.size())) {
+					dbus_message_iter_abandon_container(iter,&sub);
+					throw std::runtime_error("Can't add array to d-bus iterator");
+				}
+
+				close_container(iter,&sub);
+
+			}
+
+			static void pop(DBusMessageIter *iter, Span<T> &value) {
+
+				DBusMessageIter sub;
+				dbus_message_iter_recurse(iter,&sub);
+
+				const T *elements = nullptr;
+				int length = 0;
+				dbus_message_iter_get_fixed_array(&sub,&elements,&length);
+				value = Span<T>{elements,(size_t) length};
+
+				dbus_message_iter_next(iter);
+
+			}
+
+		};
+
+		/// @brief Dictionaries, 'a{' + key + value + '}'.
+		template <typename K, typename V>
+		struct Type<std::map<K,V>> {
+
+			static constexpr auto entry = make_signature("{") + Type<K>::signature + Type<V>::signature + make_signature("}");
+
+			static constexpr auto signature = make_signature("a") + entry;
+
+			static void push(DBusMessageIter *iter, const std::map<K,V> &value) {
+
+				DBusMessageIter sub;
+				open_container(iter,DBUS_TYPE_ARRAY,entry.c_str(),&sub);
+
+				for(const auto &it : value) {
+					DBusMessageIter item;
+					open_container(&sub,DBUS_TYPE_DICT_ENTRY,NULL,&item);
+					Type<K>::push(&item,it.first);
+					Type<V>::push(&item,it.second);
+					close_container(&sub,&item);
+				}
+
+				close_container(iter,&sub);
+
+			}
+
+			static void pop(DBusMessageIter *iter, std::map<K,V> &value) {
+
+				DBusMessageIter sub;
+				dbus_message_iter_recurse(iter,&sub);
+
+				value.clear();
+
+				while(dbus_message_iter_get_arg_type(&sub) == DBUS_TYPE_DICT_ENTRY) {
+					DBusMessageIter item;
+					dbus_message_iter_recurse(&sub,&item);
+					K key;
+					Type<K>::pop(&item,key);
+					Type<V>::pop(&item,value[key]);
+					dbus_message_iter_next(&sub);
+				}
+
+				dbus_message_iter_next(iter);
+
+			}
+
+		};
+
+		/// @brief Structs, '(' + members + ')'.
+		template <typename... T>
+		struct Type<std::tuple<T...>> {
+
+			static constexpr auto signature = (make_signature("(") + ... + Type<T>::signature) + make_signature(")");
+
+			static void push(DBusMessageIter *iter, const std::tuple<T...> &value) {
+				DBusMessageIter sub;
+				open_container(iter,DBUS_TYPE_STRUCT,NULL,&sub);
+				std::apply([&sub](const T &... members){
+					(Type<T>::push(&sub,members), ...);
+				},value);
+				close_container(iter,&sub);
+			}
+
+			static void pop(DBusMessageIter *iter, std::tuple<T...> &value) {
+				DBusMessageIter sub;
+				dbus_message_iter_recurse(iter,&sub);
+				std::apply([&sub](T &... members){
+					(Type<T>::pop(&sub,members), ...);
+				},value);
+				dbus_message_iter_next(iter);
+			}
+
+		};
+
+		/// @brief Optional values, as an array with zero or one element.
+		template <typename T>
+		struct Type<std::optional<T>> {
+
+			static constexpr auto signature = make_signature("a") + Type<T>::signature;
+
+			static void push(DBusMessageIter *iter, const std::optional<T> &value) {
+				DBusMessageIter sub;
+				open_container(iter,DBUS_TYPE_ARRAY,Type<T>::signature.c_str(),&sub);
+				if(value) {
+					Type<T>::push(&sub,*value);
+				}
+				close_container(iter,&sub);
+			}
+
+			static void pop(DBusMessageIter *iter, std::optional<T> &value) {
+				DBusMessageIter sub;
+				dbus_message_iter_recurse(iter,&sub);
+				value.reset();
+				if(dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_INVALID) {
+					Type<T>::pop(&sub,value.emplace());
+				}
+				dbus_message_iter_next(iter);
+			}
+
+		};
+
+		/// @brief User structs, marshalled as '(' + members + ')'.
+		/// @tparam S The struct.
+		/// @tparam Members Pointers to the members, in the d-bus order.
+		template <typename S, auto... Members>
+		struct Fields {
+
+			template <auto Member>
+			using member_type = typename std::decay<decltype(std::declval<S &>().*Member)>::type;
+
+			static constexpr auto signature = (make_signature("(") + ... + Type<member_type<Members>>::signature) + make_signature(")");
+
+			static void push(DBusMessageIter *iter, const S &value) {
+				DBusMessageIter sub;
+				open_container(iter,DBUS_TYPE_STRUCT,NULL,&sub);
+				(Type<member_type<Members>>::push(&sub,value.*Members), ...);
+				close_container(iter,&sub);
+			}
+
+			static void pop(DBusMessageIter *iter, S &value) {
+				DBusMessageIter sub;
+				dbus_message_iter_recurse(iter,&sub);
+				(Type<member_type<Members>>::pop(&sub,value.*Members), ...);
+				dbus_message_iter_next(iter);
+			}
+
+		};
+
+		/// @brief Top level arguments of a message.
+		/// @details A tuple is read as the list of arguments, any other type as the only one.
+		template <typename T>
+		struct Results {
+
+			static constexpr auto signature = Type<T>::signature;
+
+			static void pop(DBusMessage *message, T &value) {
+				check_signature(message,signature.c_str());
+				DBusMessageIter iter;
+				dbus_message_iter_init(message,&iter);
+				Type<T>::pop(&iter,value);
+			}
+
+		};
+
+		template <typename... T>
+		struct Results<std::tuple<T...>> {
+
+			static constexpr auto signature = (make_signature("") + ... + Type<T>::signature);
+
+			static void pop(DBusMessage *message, std::tuple<T...> &value) {
+				// Checked once, the values are read without type dispatch.
+				check_signature(message,signature.c_str());
+				DBusMessageIter iter;
+				dbus_message_iter_init(message,&iter);
+				std::apply([&iter](T &... members){
+					(Type<T>::pop(&iter,members), ...);
+				},value);
+			}
+
+		};
+
+	}
+
+ }
+
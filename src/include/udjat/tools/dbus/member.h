@@ -29,37 +29,126 @@
  #include <udjat/tools/string.h>
  #include <string>
  #include <functional>
+ #include <memory>
+ #include <mutex>
+ #include <condition_variable>
+ #include <thread>
+ #include <deque>
+ #include <vector>
  #include <udjat/tools/xml.h>
 
  namespace Udjat {
 
 	namespace DBus {
 
-		class UDJAT_API Member : public std::string {
+		class UDJAT_API Member : public std::string, public std::enable_shared_from_this<Member> {
+		public:
+
+			/// @brief How the callback is invoked.
+			enum Mode : uint8_t {
+				Inline,		///< @brief Call from the dispatcher thread (default).
+				Pooled,		///< @brief Call from the worker pool, keeping the message order for this member.
+			};
+
+			/// @brief Extra constraints, sent to the bus daemon as part of the match rule.
+			struct Match {
+				std::string sender;			///< @brief Sender name (empty for any).
+				std::string path;			///< @brief Object path (empty for any).
+				std::string path_namespace;	///< @brief Object path and its children (empty for any).
+
+				/// @brief String arguments, as (argument index, value).
+				std::vector<std::pair<unsigned int,std::string>> args;
+
+				Match() = default;
+				Match(const XML::Node &node);
+
+				inline bool empty() const noexcept {
+					return sender.empty() && path.empty() && path_namespace.empty() && args.empty();
+				}
+
+			};
+
 		private:
 			std::function<bool(Message & message)> callback;
 
+			/// @brief Messages waiting for the worker pool.
+			mutable struct {
+				std::mutex guard;
+				std::condition_variable idle;	///< @brief Signaled when the callback returns.
+				std::deque<std::shared_ptr<const Arguments>> messages;
+				bool busy = false;		///< @brief True if there's a worker draining the queue.
+				bool running = false;	///< @brief True while the callback is running on a worker.
+				bool removed = false;	///< @brief True after cancel(), no more callbacks.
+				std::thread::id worker;	///< @brief The thread running the callback.
+			} pending;
+
+			/// @brief Call the callback for the queued messages, from the worker pool.
+			void drain() const noexcept;
+
+			/// @brief Call the callback, log errors.
+			void invoke(const std::shared_ptr<const Arguments> &arguments) const noexcept;
+
 		protected:
 			int type;
 
+			Mode mode = Inline;
+
+			Match match;
+
 		public:
 
 			static Udjat::String NameFactory(const XML::Node &node);
 
-			Member(const char *name, const std::function<bool(Message & message)> &callback);
+			Member(const char *name, const std::function<bool(Message & message)> &callback, const Mode mode = Inline);
+			Member(const char *name, const Match &match, const std::function<bool(Message & message)> &callback, const Mode mode = Inline);
 			Member(const XML::Node &node,const std::function<bool(Message & message)> &callback);
 			~Member();
 
+			Member(const Member &) = delete;
+			Member & operator=(const Member &) = delete;
+
+			/// @brief Set dispatch mode.
+			inline void set(const Mode m) noexcept {
+				mode = m;
+			}
+
+			inline Mode dispatch_mode() const noexcept {
+				return mode;
+			}
+
 			bool operator==(const char *name) const noexcept;
 
 			inline bool operator==(const int t) const noexcept {
 				return type == t;
 			}
 
+			/// @brief Get the d-bus message type handled by this member.
+			inline int message_type() const noexcept {
+				return type;
+			}
+
 			inline void call(Message &message) const {
 				callback(message);
 			}
 
+			/// @brief Deliver incoming message according to the dispatch mode.
+			/// @param arguments The message arguments, shared with the other members.
+			void dispatch(const std::shared_ptr<const Arguments> &arguments) const;
+
+			/// @brief Stop delivering messages, wait for the running pooled callback.
+			/// @details Called on unsubscribe, after that the callback is never called again;
+			/// don't call it with a lock the callback can take.
+			void cancel() const noexcept;
+
+			/// @brief Check the message against the member constraints.
+			/// @details The bus already filters by the match rule; this check is required
+			/// because other subscribers on the same connection can use broader rules.
+			bool matches(const Arguments &arguments) const noexcept;
+
+			/// @brief Get textual form of match rule for this member.
+			/// @param interface The interface name.
+			std::string rule(const char *interface) const;
+
 		};
 
 	}
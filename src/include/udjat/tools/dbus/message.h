@@ -25,14 +25,116 @@
  #include <udjat/defs.h>
  #include <udjat/tools/value.h>
  #include <dbus/dbus.h>
+ #include <udjat/tools/dbus/defs.h>
+ #include <udjat/tools/dbus/marshal.h>
+ #include <udjat/tools/dbus/unixfd.h>
  #include <string>
+ #include <string_view>
+ #include <memory>
  #include <udjat/tools/string.h>
  
  namespace Udjat {
 
  	namespace DBus {
 
- 		/// @brief D-Bus message
+ 		/// @brief Lazy cursor over message arguments, values are decoded on demand.
+		/// @details A cursor is its own range, so it works on range-based loops:
+		/// @code
+		/// for(auto arg : message.args()) {
+		/// 	if(arg.type() == DBUS_TYPE_ARRAY) {
+		/// 		for(auto element : arg.recurse()) {
+		/// 			...
+		/// 		}
+		/// 	}
+		/// }
+		/// @endcode
+		/// It points to the message buffer, keep the message alive while using it.
+		class UDJAT_API Cursor {
+		private:
+			bool valid = false;
+			DBusMessageIter iter;
+
+		public:
+
+			/// @brief Build the end cursor.
+			Cursor() = default;
+
+			/// @brief Build cursor on the iterator position.
+			Cursor(const DBusMessageIter &iter) noexcept;
+
+			/// @brief Get the d-bus type code, DBUS_TYPE_INVALID at the end.
+			inline int type() const noexcept {
+				return valid ? dbus_message_iter_get_arg_type((DBusMessageIter *) &iter) : DBUS_TYPE_INVALID;
+			}
+
+			/// @brief Get the element type, for arrays.
+			int element_type() const noexcept;
+
+			/// @brief Get the signature of the argument.
+			std::string signature() const;
+
+			inline operator bool() const noexcept {
+				return type() != DBUS_TYPE_INVALID;
+			}
+
+			/// @brief Move to the next argument, without decoding this one.
+			/// @return false if there are no more arguments.
+			bool skip() noexcept;
+
+			/// @brief Get cursor on the contents of an array, struct, dictionary entry or variant.
+			Cursor recurse() const;
+
+			/// @brief Get string, object path or signature without copying it.
+			std::string_view view() const;
+
+			/// @brief Decode the argument to a value.
+			void get(Udjat::Value &value) const;
+
+			/// @brief Decode typed argument, it must match the DBus::Type<T> signature.
+			template <typename T, typename std::enable_if<is_marshallable<T>::value,int>::type = 0>
+			T get() const {
+
+				DBusMessageIter it = iter;
+
+				if constexpr (Type<T>::signature.size() == 1) {
+					// Basic type, the type code is enough.
+					if(type() != Type<T>::signature.value[0]) {
+						check_signature(&it,Type<T>::signature.c_str());
+					}
+				} else {
+					check_signature(&it,Type<T>::signature.c_str());
+				}
+
+				T value{};
+				Type<T>::pop(&it,value);
+				return value;
+
+			}
+
+			inline Cursor & operator++() noexcept {
+				skip();
+				return *this;
+			}
+
+			inline const Cursor & operator*() const noexcept {
+				return *this;
+			}
+
+			inline bool operator!=(const Cursor &other) const noexcept {
+				return (bool) *this != (bool) other;
+			}
+
+			inline Cursor begin() const noexcept {
+				return *this;
+			}
+
+			inline Cursor end() const noexcept {
+				return Cursor{};
+			}
+
+		};
+
+		/// @brief D-Bus message
 		class UDJAT_API Message {
 		protected:
 
@@ -46,6 +148,15 @@
 
 		private:
 
+			/// @brief Shared decoded arguments, empty if reading from the message iterator.
+			struct {
+				std::shared_ptr<const Arguments> values;
+				size_t index = 0;	///< @brief Cursor on the shared arguments.
+			} shared;
+
+			/// @brief Stop using the shared arguments, move the message iterator to the cursor.
+			void detach();
+
 			struct {
 				bool valid = false;		/// @brief True if this is an error message.
 				std::string name;		/// @brief Error name.
@@ -80,6 +191,10 @@
 			Message(const DBusError &error);
 			Message(DBusMessage *m);
 
+			/// @brief Build message from shared decoded arguments.
+			/// @details Each message has its own cursor, the arguments are decoded only once.
+			Message(const std::shared_ptr<const Arguments> &arguments);
+
 			~Message();
 
 			inline operator DBusMessage *() const noexcept {
@@ -87,6 +202,7 @@
 			}
 
 			inline operator DBusMessageIter *() noexcept {
+				detach();
 				return &message.iter;
 			}
 
@@ -122,13 +238,30 @@
 			/// @return true if iteration was stopped by the call function returning true.
 			bool for_each(const std::function<bool (const Udjat::Value &value)> &call);
 
+			/// @brief Get lazy cursor on the first argument.
+			/// @details Independent of pop(), nothing is decoded until asked for.
+			Cursor args() const;
+
 			Message & pop(Udjat::Value &value);
 			Message & pop(std::string &value);
+
+			/// @brief Get string without copying it, valid while the message is alive.
+			Message & pop(std::string_view &value);
 			Message & pop(int &value);
 			Message & pop(unsigned int &value);
 			Message & pop(bool &value);
 			Message & pop(double &value);
 
+			/// @brief Get typed value, the argument must match the DBus::Type<T> signature.
+			template <typename T, typename std::enable_if<is_poppable<T>::value,int>::type = 0>
+			Message & pop(T &value) {
+				DBusMessageIter *iter = getIter();
+				check_signature(iter,Type<T>::signature.c_str());
+				Type<T>::pop(iter,value);
+				message.valid = (dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_INVALID);
+				return *this;
+			}
+
 			inline const char * error_name() const {
 				return this->err.name.c_str();
 			}
@@ -150,6 +283,14 @@
 			Message & push_back(const unsigned int value);
 			Message & push_back(const double value);
 
+			/// @brief Add typed value, with the DBus::Type<T> signature.
+			/// @details Integral types narrower than int use the non template overloads.
+			template <typename T, typename std::enable_if<is_appendable<T>::value,int>::type = 0>
+			Message & push_back(const T &value) {
+				Type<T>::push(&message.iter,value);
+				return *this;
+			}
+
 			Udjat::String to_string();
 
 		};
@@ -0,0 +1,131 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+ /**
+  * @brief Declare D-Bus asynchronous reply.
+  */
+
+ #pragma once
+ #include <udjat/defs.h>
+ #include <udjat/tools/dbus/defs.h>
+ #include <udjat/tools/dbus/message.h>
+ #include <memory>
+ #include <functional>
+ #include <future>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+ #include <coroutine>
+ #include <exception>
+ #define UDJAT_DBUS_COROUTINES 1
+#endif
+
+ namespace Udjat {
+
+ 	namespace DBus {
+
+		/// @brief Reply of an asynchronous method call.
+		/// @details Can be used as a future, with a continuation or, on C++20, with co_await.
+		/// Never use get() from the main loop thread, the reply is delivered by it.
+		class UDJAT_API Reply {
+		private:
+			friend class Connection;
+
+			struct State;
+			std::shared_ptr<State> state;
+
+			/// @brief Completes the reply when the pending call is released.
+			struct Completion;
+
+			/// @brief Store the response, run the continuation.
+			void complete(Message &response) const;
+
+		public:
+			Reply();
+			~Reply();
+
+			/// @brief Is the reply available?
+			bool ready() const;
+
+			/// @brief Wait for the reply.
+			/// @return The response, check it with Message::failed().
+			std::shared_ptr<Message> get() const;
+
+			/// @brief Get a future for the response.
+			std::shared_future<std::shared_ptr<Message>> future() const;
+
+			/// @brief Set method to call when the reply arrives.
+			/// @details Called immediately if the reply is already available.
+			void then(const std::function<void(const std::shared_ptr<Message> &response)> &call) const;
+
+			/// @brief Log exception escaping from a coroutine.
+			static void failed(std::exception_ptr exception) noexcept;
+
+#ifdef UDJAT_DBUS_COROUTINES
+
+			inline bool await_ready() const {
+				return ready();
+			}
+
+			inline void await_suspend(std::coroutine_handle<> handle) const {
+				then([handle](const std::shared_ptr<Message> &) {
+					handle.resume();
+				});
+			}
+
+			inline std::shared_ptr<Message> await_resume() const {
+				return get();
+			}
+
+#endif // UDJAT_DBUS_COROUTINES
+
+		};
+
+#ifdef UDJAT_DBUS_COROUTINES
+
+		/// @brief Fire and forget coroutine, for sequential code using co_await on replies.
+		struct Task {
+			struct promise_type {
+
+				inline Task get_return_object() noexcept {
+					return {};
+				}
+
+				inline std::suspend_never initial_suspend() noexcept {
+					return {};
+				}
+
+				inline std::suspend_never final_suspend() noexcept {
+					return {};
+				}
+
+				inline void return_void() noexcept {
+				}
+
+				inline void unhandled_exception() noexcept {
+					Reply::failed(std::current_exception());
+				}
+
+			};
+		};
+
+#endif // UDJAT_DBUS_COROUTINES
+
+ 	}
+
+ }
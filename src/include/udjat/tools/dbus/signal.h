@@ -26,6 +26,7 @@
  #include <string>
  #include <udjat/tools/xml.h>
  #include <udjat/tools/dbus/connection.h>
+ #include <udjat/tools/dbus/marshal.h>
  #include <dbus/dbus.h>
 
  namespace Udjat {
@@ -100,6 +101,14 @@
 			Signal & push_back(const int64_t value);
 			Signal & push_back(const uint64_t value);
 
+			/// @brief Add typed value, with the DBus::Type<T> signature.
+			/// @details Integral types narrower than int use the non template overloads.
+			template <typename T, typename std::enable_if<is_appendable<T>::value,int>::type = 0>
+			Signal & push_back(const T &value) {
+				Type<T>::push(&iter,value);
+				return *this;
+			}
+
 		};
 
 	}
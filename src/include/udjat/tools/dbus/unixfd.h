@@ -0,0 +1,110 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ /**
+  * @brief Declares DBus::UnixFd, file descriptors passed on d-bus messages.
+  */
+
+ #pragma once
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <udjat/tools/dbus/marshal.h>
+ #include <cstddef>
+
+ namespace Udjat {
+
+	namespace DBus {
+
+		/// @brief File descriptor owned by this object, closed on destruction.
+		/// @details Used to hand bulk data (a memfd, a pipe, a file) to the peer
+		/// instead of marshalling it through the bus daemon; check the connection
+		/// with can_send_type(DBUS_TYPE_UNIX_FD) first.
+		class UDJAT_API UnixFd {
+		private:
+			int fd = -1;
+
+		public:
+			UnixFd() = default;
+
+			/// @brief Take ownership of the file descriptor.
+			explicit UnixFd(int fd) noexcept;
+
+			UnixFd(const UnixFd &) = delete;
+			UnixFd & operator=(const UnixFd &) = delete;
+
+			UnixFd(UnixFd &&other) noexcept;
+			UnixFd & operator=(UnixFd &&other) noexcept;
+
+			~UnixFd();
+
+			inline int get() const noexcept {
+				return fd;
+			}
+
+			inline operator bool() const noexcept {
+				return fd >= 0;
+			}
+
+			/// @brief Give up the ownership.
+			/// @return The file descriptor, -1 if empty.
+			int release() noexcept;
+
+			/// @brief Close the file descriptor.
+			void reset() noexcept;
+
+			/// @brief Copy the buffer to a sealed memfd.
+			/// @details The peer gets a read-only snapshot: the memfd can't be written,
+			/// resized or unsealed after this call.
+			/// @param data The buffer.
+			/// @param length The buffer length.
+			/// @param name Name for debugging, shown on /proc/self/fd.
+			/// @return The memfd, positioned at the start.
+			static UnixFd memfd(const void *data, size_t length, const char *name = "udjat-dbus");
+
+		};
+
+		/// @brief File descriptors ('h'), libdbus duplicates them on both ends.
+		template <>
+		struct Type<UnixFd> {
+
+			static constexpr Signature<1> signature{{(char) DBUS_TYPE_UNIX_FD, 0}};
+
+			static constexpr int type = DBUS_TYPE_UNIX_FD;
+
+			static void push(DBusMessageIter *iter, const UnixFd &value) {
+				int fd = value.get();
+				if(!dbus_message_iter_append_basic(iter,DBUS_TYPE_UNIX_FD,&fd)) {
+					throw std::runtime_error("Can't add file descriptor to d-bus iterator");
+				}
+			}
+
+			static void pop(DBusMessageIter *iter, UnixFd &value) {
+				int fd = -1;
+				dbus_message_iter_get_basic(iter,&fd);
+				value = UnixFd{fd};
+				dbus_message_iter_next(iter);
+			}
+
+		};
+
+	}
+
+ }
+
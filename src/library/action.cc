@@ -29,6 +29,7 @@
  #include <udjat/tools/memory.h>
  #include <udjat/tools/logger.h>
  #include <private/messagedata.h>
+ #include <fcntl.h>
 
  using namespace std;
 
@@ -43,8 +44,10 @@
 		  message_type{dbus_message_type_from_string(String{node,"dbus-message-type","method_call"}.c_str())},
 		  bustype{BusTypeFactory(node)},
 		  path{String{node,"dbus-path"}.as_quark()},
+		  destination{String{node,"dbus-destination"}.as_quark()},
 		  iface{String{node,"dbus-interface"}.as_quark()},
-		  member{String{node,"dbus-member"}.as_quark()} {
+		  member{String{node,"dbus-member"}.as_quark()},
+		  timeout{node.attribute("dbus-timeout").as_int(DBUS_TIMEOUT_USE_DEFAULT)} {
 
 		const char *props[] = {path,iface,member};
 		const char *names[] = {"dbus-path","dbus-interface","dbus-member"};
@@ -71,6 +74,10 @@
 	}
 
 	std::shared_ptr<DBusMessage> DBus::Action::MessageFactory(const std::vector<String> &vals) {
+		return MessageFactory(vals,nullptr);
+	}
+
+	std::shared_ptr<DBusMessage> DBus::Action::MessageFactory(const std::vector<String> &vals, const Introspection::Method *method) {
 
 		MessageData *data = new MessageData();
 
@@ -107,8 +114,16 @@
 				DBusBasicValue val;
 				memset(&val,0,sizeof(val));
 
-				switch(arguments[ix].type) {
+				// The service knows better, use the introspected type if it's a basic one.
+				int type = arguments[ix].type;
+				if(method && ix < method->input.size() && method->input[ix].signature.size() == 1 && dbus_type_is_basic(method->input[ix].type())) {
+					type = method->input[ix].type();
+				}
+
+				switch(type) {
 				case DBUS_TYPE_STRING:
+				case DBUS_TYPE_OBJECT_PATH:
+				case DBUS_TYPE_SIGNATURE:
 					{
 						// Store argument template for later use.
 						data->arguments.push_back(vals[ix]);
@@ -116,6 +131,10 @@
 					}
 					break;
 
+				case DBUS_TYPE_BYTE:
+					val.byt = static_cast<unsigned char>(atoi(vals[ix].c_str()));
+					break;
+
 				case DBUS_TYPE_INT16:
 					val.i16 = atoi(vals[ix].c_str());
 					break;
@@ -137,7 +156,7 @@
 					break;
 
 				case DBUS_TYPE_UINT64:
-					val.u64 = static_cast<uint64_t>(atoll(vals[ix].c_str()));
+					val.u64 = static_cast<uint64_t>(strtoull(vals[ix].c_str(),NULL,10));
 					break;
 
 				case DBUS_TYPE_DOUBLE:
@@ -148,11 +167,27 @@
 					val.bool_val = atoi(vals[ix].c_str()) != 0;
 					break;
 
+				case DBUS_TYPE_UNIX_FD:
+					{
+						// The argument is a file name, the service gets a read-only descriptor.
+						UnixFd file{::open(vals[ix].c_str(),O_RDONLY|O_CLOEXEC)};
+						if(!file) {
+							throw std::system_error(errno,system_category(),vals[ix]);
+						}
+						val.fd = file.get();
+
+						// libdbus keeps a copy, this one is closed on the way out.
+						if(!dbus_message_iter_append_basic(&iter,type,&val)) {
+							throw runtime_error("Can't add value to d-bus iterator");
+						}
+					}
+					continue;
+
 				default:
 					throw std::system_error(ENOTSUP,system_category(),"Unsupported D-Bus argument type");
 				}
 
-				if(!dbus_message_iter_append_basic(&iter,arguments[ix].type,&val)) {
+				if(!dbus_message_iter_append_basic(&iter,type,&val)) {
 					throw runtime_error("Can't add value to d-bus iterator");
 				}
 
@@ -175,29 +210,48 @@
 				vals.push_back(str);
 			}
 
-			auto query = MessageFactory(vals);
-
-			MessageData *data = 
-				(MessageData *) dbus_message_get_data(
-					query.get(),
-					MessageData::getSlot().value()
-				);
-
-			data->iface = String{iface}.expand(true);
-			if(data->iface.empty()) {
+			String ifname{iface};
+			ifname.expand(true);
+			if(ifname.empty()) {
 				throw std::runtime_error("D-Bus interface cannot be empty");
 			}
-			
-			data->path = String{path}.expand(true);
-			if(data->path.empty()) {
+
+			String pathname{path};
+			pathname.expand(true);
+			if(pathname.empty()) {
 				throw std::runtime_error("D-Bus path cannot be empty");
 			}
 
-			data->member = String{member}.expand(true);
-			if(data->member.empty()) {
+			String membername{member};
+			membername.expand(true);
+			if(membername.empty()) {
 				throw std::runtime_error("D-Bus member cannot be empty");
 			}
 
+			// Method description, to get the argument types and the response names.
+			std::shared_ptr<const Introspection> introspection;
+			const Introspection::Method *method = nullptr;
+			if(message_type == DBUS_MESSAGE_TYPE_METHOD_CALL && destination && *destination) {
+				try {
+					introspection = Connection::getInstance(bustype).introspect(destination,pathname.c_str(),timeout);
+					method = introspection->method(ifname.c_str(),membername.c_str());
+				} catch(const std::exception &e) {
+					Logger::String{"Can't introspect ",destination,pathname.c_str(),": ",e.what()}.warning(name());
+				}
+			}
+
+			auto query = MessageFactory(vals,method);
+
+			MessageData *data = 
+				(MessageData *) dbus_message_get_data(
+					query.get(),
+					MessageData::getSlot().value()
+				);
+
+			data->iface = ifname;
+			data->path = pathname;
+			data->member = membername;
+
 			dbus_message_set_interface(query.get(),data->iface.c_str());
 			dbus_message_set_path(query.get(),data->path.c_str());
 			dbus_message_set_member(query.get(),data->member.c_str());
@@ -208,41 +262,35 @@
 				return 0;
 			}
 
-			// TODO: Check for introspection to get property names.
+			// Through the connection, so the circuit breaker can fail it fast.
+			bool answered = false;
+			Connection::getInstance(bustype).call_and_wait(query.get(),[&answered,&response,method](DBus::Message &msg){
 
-			DBusError error;
-			dbus_error_init(&error);
+				if(msg.failed()) {
+					throw runtime_error(Logger::String{"D-Bus call error: ",msg.error_name()," - ",msg.error_message()});
+				}
 
-			debug("Calling and waiting...");
-			
-			DBusMessage * rsp =
-				dbus_connection_send_with_reply_and_block(
-					Connection::getInstance(bustype).get(),
-					query.get(),
-					DBUS_TIMEOUT_USE_DEFAULT,
-					&error
-				);
+				answered = true;
+
+				// Named output arguments become named fields, the others are appended.
+				size_t index = 0;
+				msg.for_each([&response,method,&index](const Udjat::Value &value) {
+					const Introspection::Argument *arg = (method && index < method->output.size()) ? &method->output[index] : nullptr;
+					index++;
+					if(arg && !arg->name.empty()) {
+						response[arg->name.c_str()].set(value);
+					} else {
+						response.append(value);
+					}
+					return false;
+				});
 
-			if(dbus_error_is_set(&error)) {
-				if(rsp) {
-					dbus_message_unref(rsp);
-				}
-				throw runtime_error(Logger::String{"D-Bus call error: ",error.name," - ",error.message});
-			}
+			},timeout);
 
-			if(!rsp) {
+			if(!answered) {
 				throw runtime_error("No response received from D-Bus call");
 			}
 
-			DBus::Message msg{rsp};
-			dbus_message_unref(rsp);
-
-			// TODO: Use introspection data to build proper response.
-			msg.for_each([&response](const Udjat::Value &value) {
-				response.append(value);
-				return false;
-			});
-
 		} catch(const system_error &e) {
 	
 			if(except) {
@@ -311,7 +359,7 @@
 			}.trace(name());
 
 			auto copy = make_handle(dbus_message_copy(message.get()),dbus_message_unref);
-			Connection::getInstance(bustype).call(copy.get());
+			Connection::getInstance(bustype).call(copy.get(),timeout);
 
 		} catch(const system_error &e) {
 			if(except) {
@@ -125,7 +125,7 @@
 			}.trace(Udjat::Alert::name());
 
 			auto copy = make_handle(dbus_message_copy(message.get()),dbus_message_unref);
-			Connection::getInstance(bustype).call(copy.get());
+			Connection::getInstance(bustype).call(copy.get(),timeout);
 
 		} catch(const system_error &e) {
 			
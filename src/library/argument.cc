@@ -42,6 +42,7 @@
 			{"double", DBUS_TYPE_DOUBLE},
 			{"objectpath", DBUS_TYPE_OBJECT_PATH},
 			{"signature", DBUS_TYPE_SIGNATURE},
+			{"unixfd", DBUS_TYPE_UNIX_FD},
 			{nullptr, DBUS_TYPE_INVALID}
 		};
 
@@ -38,13 +38,14 @@
  #include <udjat/tools/string.h>
  
  #include <private/mainloop.h>
+ #include <private/subscriptions.h>
+ #include <private/arguments.h>
+ #include <private/breaker.h>
  
  using namespace std;
 
  namespace Udjat {
 
-	std::mutex DBus::Connection::guard;
-
 	bool DBus::initialize() {
 		static bool initialized = false;
 		if(!initialized) {
@@ -88,7 +89,38 @@
 	}
 
 	DBus::Connection & DBus::Connection::getInstance(const XML::Node &node) {
-		return getInstance(DBus::BusTypeFactory(node));
+
+		DBus::Connection &connection = getInstance(DBus::BusTypeFactory(node));
+
+		// Opt-in for a dedicated service thread; it's shared, the first one to ask wins.
+		if(!connection.threaded() && node.attribute("dbus-service-thread").as_bool(false)) {
+			connection.start(strcasecmp(String{node,"dbus-callbacks","thread"}.c_str(),"mainloop") == 0);
+		}
+
+		if(node.attribute("dbus-property-cache").as_bool(false)) {
+			connection.property_cache();
+		}
+
+		if(node.attribute("dbus-single-flight").as_bool(false)) {
+			connection.single_flight();
+		}
+
+		{
+			unsigned int limit = node.attribute("dbus-max-in-flight").as_uint(0);
+			if(limit) {
+				connection.max_in_flight(limit);
+			}
+		}
+
+		{
+			unsigned int failures = node.attribute("dbus-circuit-breaker").as_uint(0);
+			if(failures) {
+				connection.circuit_breaker(failures,node.attribute("dbus-circuit-interval").as_uint(5000));
+			}
+		}
+
+		return connection;
+
 	}
 
 	DBus::Connection & DBus::Connection::getInstance(DBusBusType bustype) {
@@ -108,12 +140,14 @@
 
 	}
 
-	DBus::Connection::Connection(const char *name, DBusConnection *c) : object_name{name}, conn{c} {
+	DBus::Connection::Connection(const char *name, DBusConnection *c) : object_name{name}, subscriptions{std::make_shared<const Subscriptions>()}, conn{c} {
 
 		lock_guard<mutex> lock(guard);
 
 		initialize();
 
+		names = NamesFactory(*this);
+
 		// Keep running if d-bus disconnect.
 		dbus_connection_set_exit_on_disconnect(conn, false);
 
@@ -151,15 +185,49 @@
 
 	void DBus::Connection::clear() {
 
-		lock_guard<mutex> lock(guard);
+		// Without the guard, callbacks running on the service thread can use it.
+		stop();
 
-		flush();
+		{
+			// The circuit breaker can outlive the connection on pending calls.
+			auto circuit = std::atomic_load(&breaker);
+			if(circuit) {
+				circuit->unwatch();
+			}
+		}
 
-		// Remove interfaces.
-		interfaces.clear();
+		std::vector<std::shared_ptr<Member>> removed;
 
-		// Remove filter
-		dbus_connection_remove_filter(conn,(DBusHandleMessageFunction) on_message, this);
+		{
+			lock_guard<mutex> lock(guard);
+
+			// Drop rules not yet sent, the bus removes the active ones when the connection closes.
+			rules.reset();
+
+			// The cache subscriptions go away with the interfaces.
+			properties.reset();
+			introspections.reset();
+			names = NamesFactory(*this);
+
+			flush();
+
+			// Remove interfaces.
+			publish(std::make_shared<const Subscriptions>());
+			for(auto &interface : interfaces) {
+				for(const auto &member : interface.members) {
+					removed.push_back(member);
+				}
+			}
+			interfaces.clear();
+
+			// Remove filter
+			dbus_connection_remove_filter(conn,(DBusHandleMessageFunction) on_message, this);
+		}
+
+		// Without the guard, the running callbacks can use it.
+		for(auto &member : removed) {
+			member->cancel();
+		}
 
 	}
 
@@ -178,8 +246,6 @@
 
 	DBusHandlerResult DBus::Connection::on_message(DBusConnection *, DBusMessage *message, DBus::Connection *connection) noexcept {
 
-		lock_guard<mutex> lock(connection->guard);
-
 		try {
 
 			return connection->filter(message);
@@ -210,18 +276,30 @@
 	}
 
 
+	std::shared_ptr<const DBus::Subscriptions> DBus::Connection::snapshot() const noexcept {
+		return std::atomic_load(&subscriptions);
+	}
+
+	void DBus::Connection::publish(std::shared_ptr<const Subscriptions> table) noexcept {
+		std::atomic_store(&subscriptions,table);
+	}
+
 	DBusHandlerResult DBus::Connection::filter(DBusMessage *message) {
 
-		const char *interface = dbus_message_get_interface(message);
-		for(const auto &intf : interfaces) {
+		// No lock here, the snapshot keeps the members alive even if
+		// a callback subscribes or unsubscribes while we are dispatching.
+		auto table = snapshot();
 
-			if(intf == interface) {
+		auto members = table->find(message);
+		if(members) {
 
-				DBusHandlerResult rc = intf.filter(message);
-				if(rc != DBUS_HANDLER_RESULT_NOT_YET_HANDLED) {
-					return rc;
-				}
+			// Decoded once, every member gets its own cursor.
+			auto arguments = make_shared<const Arguments>(message);
 
+			for(const auto &member : *members) {
+				if(member->matches(*arguments)) {
+					dispatch(member,arguments);
+				}
 			}
 
 		}
@@ -230,57 +308,29 @@
 
 	}
 
-	bool DBus::Connection::name_has_owner(const char *name) const {
-
-		DBus::Error error;
-		dbus_bool_t rc = dbus_bus_name_has_owner(conn, name, error);
-		error.verify();
-		return rc;
-
-	};
-
-	void DBus::Connection::flush() noexcept {
-		dbus_connection_flush(conn);
+	void DBus::Connection::index(const Udjat::DBus::Interface &interface, const std::shared_ptr<const Udjat::DBus::Member> &member) {
+		publish(snapshot()->insert(interface,member));
+		add_match(member->rule(interface.c_str()).c_str());
 	}
 
-	void DBus::Connection::insert(const Udjat::DBus::Interface &interface) {
-
-		Logger::String{"Connecting to '",interface.rule().c_str(),"'"}.trace(name());
-
-		DBusError error;
-		dbus_error_init(&error);
-
-		dbus_bus_add_match(conn,interface.rule().c_str(), &error);
-		dbus_connection_flush(conn);
-
-		if (dbus_error_is_set(&error)) {
-			Logger::String message{"Error '",error.message,"' adding rule ",interface.rule().c_str()};
-			dbus_error_free(&error);
-			throw std::runtime_error(message);
-		}
-
+	void DBus::Connection::unindex(const Udjat::DBus::Interface &interface, const Udjat::DBus::Member &member) {
+		publish(snapshot()->remove(interface,member));
+		remove_match(member.rule(interface.c_str()).c_str());
 	}
 
-	void DBus::Connection::remove(const Udjat::DBus::Interface &interface) {
-
-		Logger::String{"Disconnecting from '",interface.rule().c_str(),"'"}.trace(name());
-
-		DBusError error;
-		dbus_error_init(&error);
-
-		dbus_bus_remove_match(conn,interface.rule().c_str(), &error);
-
-		if(dbus_error_is_set(&error)) {
-			Logger::String{"Error '",error.message,"' removing interface '",interface.c_str(),"'"}.error(name());
-			dbus_error_free(&error);
-		}
-
+	void DBus::Connection::flush() noexcept {
+		dbus_connection_flush(conn);
 	}
 
 	void DBus::Connection::push_back(Udjat::DBus::Interface &intf) {
 		lock_guard<mutex> lock(guard);
-		insert(intf);
 		interfaces.push_back(intf);
+
+		Udjat::DBus::Interface &inserted = interfaces.back();
+		inserted.connection = this;
+		for(const auto &member : inserted.members) {
+			index(inserted,member);
+		}
 	}
 
 	Udjat::DBus::Interface & DBus::Connection::emplace_back(const char *intf) {
@@ -304,7 +354,7 @@
 		interfaces.emplace_back(intf);
 		Udjat::DBus::Interface & interface = interfaces.back();
 #endif
-		insert(interface);
+		interface.connection = this;
 
 		return interface;
 	}
@@ -318,31 +368,78 @@
 		return emplace_back(interface).emplace_back(member,callback);
 	}
 
+	Udjat::DBus::Member & DBus::Connection::subscribe(const char *interface, const char *member, const std::function<bool(Udjat::DBus::Message &message)> &callback, const Member::Mode mode) {
+		return emplace_back(interface).emplace_back(member,callback,mode);
+	}
+
+	Udjat::DBus::Member & DBus::Connection::subscribe(const char *interface, const char *member, const Member::Match &match, const std::function<bool(Udjat::DBus::Message &message)> &callback, const Member::Mode mode) {
+		return emplace_back(interface).emplace_back(member,match,callback,mode);
+	}
+
 	void DBus::Connection::remove(Udjat::DBus::Interface &intf) {
-		lock_guard<mutex> lock(guard);
-		interfaces.remove(intf);
+
+		std::vector<std::shared_ptr<Member>> removed;
+
+		{
+			lock_guard<mutex> lock(guard);
+			interfaces.remove_if([this,&intf,&removed](Udjat::DBus::Interface &interface){
+				if(interface == intf) {
+					publish(snapshot()->remove(interface));
+					for(const auto &member : interface.members) {
+						remove_match(member->rule(interface.c_str()).c_str());
+						removed.push_back(member);
+					}
+					return true;
+				}
+				return false;
+			});
+		}
+
+		// Without the guard, the running callbacks can use it.
+		for(auto &member : removed) {
+			member->cancel();
+		}
+
 	}
 
 	void DBus::Connection::remove(const Udjat::DBus::Member &member) {
 
-		lock_guard<mutex> lock(guard);
-		interfaces.remove_if([this,&member](Udjat::DBus::Interface &interface){
+		// Keep the member alive until it's cancelled, the list may hold the last reference.
+		std::shared_ptr<Udjat::DBus::Member> removed;
+
+		{
+			lock_guard<mutex> lock(guard);
+			interfaces.remove_if([this,&member,&removed](Udjat::DBus::Interface &interface){
+
+				// Don't use interface.remove(), we already have the lock.
+				interface.members.remove_if([this,&interface,&member,&removed](std::shared_ptr<Udjat::DBus::Member> &m){
+					if(m.get() == &member) {
+						unindex(interface,member);
+						removed = m;
+						return true;
+					}
+					return false;
+				});
+
+				if(interface.empty()) {
+					Logger::String{"Unwatching '",interface.c_str(),"'"}.trace(name());
+					return true;
+				}
+				return false;
 
-			interface.remove(member);	
-			if(interface.empty()) {
-				Logger::String{"Unwatching '",interface.c_str(),"'"}.trace(name());
-				return true;
-			}
-			return false;
+			});
+		}
 
-		});
+		// Without the guard, the running callback can use it.
+		if(removed) {
+			removed->cancel();
+		}
 
 	}
 
 	void DBus::Connection::signal(const Udjat::DBus::Signal &sig) {
 
-		lock_guard<mutex> lock(guard);
-
+		// libdbus serializes the outgoing queue, no need to block the dispatcher.
 		dbus_bool_t rc = dbus_connection_send(conn, sig.dbus_message(), NULL);
 		dbus_connection_flush(conn);
 
@@ -0,0 +1,262 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+ /**
+  * @brief Implements pipelined method calls.
+  */
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <udjat/tools/dbus/connection.h>
+ #include <udjat/tools/dbus/message.h>
+ #include <udjat/tools/logger.h>
+ #include <private/pending.h>
+ #include <private/deferred.h>
+ #include <atomic>
+ #include <mutex>
+ #include <vector>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	namespace {
+
+	/// @brief Shared state for all the pending calls in a batch.
+	/// @details Each call holds the batch from its pending call record; the records go through
+	/// Connection::send(), with the circuit breaker, the single-flight table and the throttle.
+	struct Batch {
+
+		/// @brief Requests without response.
+		std::atomic<size_t> pending{0};
+
+		/// @brief Responses delivered, by request index.
+		std::vector<bool> completed;
+
+		/// @brief Serializes the completion flags, replies can come from any thread.
+		std::mutex guard;
+
+		std::function<void(size_t index, DBus::Message & response)> each;
+
+		std::function<void(std::vector<std::shared_ptr<DBus::Message>> & responses)> all;
+		std::vector<std::shared_ptr<DBus::Message>> responses;
+
+		/// @brief The deadline active when the batch was sent, restored for the cancelled calls.
+		const DBus::Deadline::TimePoint deadline = DBus::Deadline::limit();
+
+		Batch(size_t count) : pending{count}, completed(count,false), responses(count) {
+		}
+
+		~Batch() {
+
+			if(!pending) {
+				return;
+			}
+
+			// Released without all the responses, complete the missing ones with errors.
+			DBus::Deadline scope{deadline};
+			for(size_t index = 0; index < completed.size(); index++) {
+				if(!completed[index]) {
+					error(index,DBus::PendingCall::cancelled,"The call was cancelled");
+				}
+			}
+
+		}
+
+		void complete(size_t index, DBus::Message &response) noexcept {
+
+			{
+				std::lock_guard<std::mutex> lock(guard);
+				if(completed[index]) {
+					return;
+				}
+				completed[index] = true;
+			}
+
+			try {
+
+				if(each) {
+					each(index,response);
+				} else if(response.failed()) {
+					DBusError error;
+					dbus_error_init(&error);
+					dbus_set_error(&error,response.error_name(),"%s",response.error_message());
+					responses[index] = make_shared<DBus::Message>(error);
+					dbus_error_free(&error);
+				} else {
+					responses[index] = make_shared<DBus::Message>((DBusMessage *) response);
+				}
+
+				if(--pending == 0 && all) {
+					all(responses);
+				}
+
+			} catch(const std::exception &e) {
+
+				Logger::String{"Error processing batch response: ",e.what()}.error("d-bus");
+
+			} catch(...) {
+
+				Logger::String{"Unexpected error processing batch response"}.error("d-bus");
+
+			}
+
+		}
+
+		void error(size_t index, const char *name, const char *message) noexcept {
+			DBusError error;
+			dbus_error_init(&error);
+			dbus_set_error(&error,name,"%s",message);
+			DBus::Message response{error};
+			dbus_error_free(&error);
+			complete(index,response);
+		}
+
+	};
+
+	}
+
+	void DBus::Connection::send(const std::vector<DBusMessage *> &requests, const std::function<void(size_t index, Message & response)> &reply, int timeout) {
+
+		for(size_t index = 0; index < requests.size(); index++) {
+
+			try {
+
+				PendingCall *record = PendingCall::acquire();
+				try {
+					record->emplace([reply,index](Message &response){
+						reply(index,response);
+					});
+				} catch(...) {
+					PendingCall::release(record);
+					throw;
+				}
+				send(requests[index],record,timeout);
+
+			} catch(const std::exception &e) {
+
+				// Not sent, report it from the main loop, never from inside call_batch().
+				std::string message{e.what()};
+				Deferred::getInstance().push_back([reply,index,message](){
+					DBusError error;
+					dbus_error_init(&error);
+					dbus_set_error(&error,DBUS_ERROR_FAILED,"%s",message.c_str());
+					Message response{error};
+					dbus_error_free(&error);
+					reply(index,response);
+				});
+
+			}
+
+		}
+
+		// One flush for all the requests.
+		flush();
+
+	}
+
+	void DBus::Connection::call_batch(const std::vector<DBusMessage *> &requests, const std::function<void(size_t index, Message & response)> &call, int timeout) {
+
+		if(!conn) {
+			throw logic_error("Connection is not available");
+		}
+
+		if(requests.empty()) {
+			return;
+		}
+
+		for(auto request : requests) {
+			check_fds(request);
+		}
+
+		auto batch = make_shared<Batch>(requests.size());
+		batch->each = call;
+		send(requests,[batch](size_t index, Message &response){
+			batch->complete(index,response);
+		},timeout);
+
+	}
+
+	void DBus::Connection::call_batch(const std::vector<DBusMessage *> &requests, const std::function<void(std::vector<std::shared_ptr<Message>> & responses)> &call, int timeout) {
+
+		if(!conn) {
+			throw logic_error("Connection is not available");
+		}
+
+		if(requests.empty()) {
+			std::vector<std::shared_ptr<Message>> responses;
+			call(responses);
+			return;
+		}
+
+		for(auto request : requests) {
+			check_fds(request);
+		}
+
+		auto batch = make_shared<Batch>(requests.size());
+		batch->all = call;
+		send(requests,[batch](size_t index, Message &response){
+			batch->complete(index,response);
+		},timeout);
+
+	}
+
+	namespace {
+
+	/// @brief Build the method calls for a batch, release them on destruction.
+	struct Requests : public std::vector<DBusMessage *> {
+
+		Requests(const std::vector<DBus::Connection::Method> &methods) {
+			reserve(methods.size());
+			for(const auto &method : methods) {
+				DBusMessage *message = dbus_message_new_method_call(method.destination,method.path,method.interface,method.member);
+				if(!message) {
+					clear();
+					throw std::runtime_error("Error creating DBus method call");
+				}
+				push_back(message);
+			}
+		}
+
+		~Requests() {
+			clear();
+		}
+
+		void clear() noexcept {
+			for(DBusMessage *message : *this) {
+				dbus_message_unref(message);
+			}
+			std::vector<DBusMessage *>::clear();
+		}
+
+	};
+
+	}
+
+	void DBus::Connection::call_batch(const std::vector<Method> &methods, const std::function<void(size_t index, Message & response)> &call, int timeout) {
+		call_batch(Requests{methods},call,timeout);
+	}
+
+	void DBus::Connection::call_batch(const std::vector<Method> &methods, const std::function<void(std::vector<std::shared_ptr<Message>> & responses)> &call, int timeout) {
+		call_batch(Requests{methods},call,timeout);
+	}
+
+ }
+
@@ -0,0 +1,287 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+ /**
+  * @brief Implements the per-destination circuit breaker.
+  */
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <udjat/tools/dbus/connection.h>
+ #include <udjat/tools/logger.h>
+ #include <private/breaker.h>
+ #include <cstring>
+ #include <vector>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	DBus::CircuitBreaker::CircuitBreaker(Connection &c, unsigned int failures, unsigned int milliseconds)
+		: connection{c}, name{c.name()}, threshold{failures}, interval{milliseconds} {
+	}
+
+	void DBus::CircuitBreaker::unwatch() noexcept {
+
+		std::vector<size_t> watchers;
+
+		{
+			lock_guard<mutex> lock(guard);
+			for(auto &it : destinations) {
+				if(it.second.watcher) {
+					watchers.push_back(it.second.watcher);
+				}
+				it.second.watcher = 0;
+				it.second.watched = false;
+			}
+		}
+
+		for(size_t id : watchers) {
+			unwatch(id);
+		}
+
+	}
+
+	void DBus::CircuitBreaker::unwatch(size_t id) noexcept {
+		try {
+			connection.unwatch_name(id);
+		} catch(const std::exception &e) {
+			Logger::String{"Can't remove name watcher: ",e.what()}.warning(name.c_str());
+		}
+	}
+
+	bool DBus::CircuitBreaker::admit(DBusMessage *message, const std::string **key) {
+
+		*key = nullptr;
+
+		const char *destination = dbus_message_get_destination(message);
+		if(!destination || dbus_message_get_type(message) != DBUS_MESSAGE_TYPE_METHOD_CALL || strcmp(destination,DBUS_SERVICE_DBUS) == 0) {
+			return true;
+		}
+
+		bool watch = false;
+
+		{
+			lock_guard<mutex> lock(guard);
+
+			auto it = destinations.find(destination);
+			if(it == destinations.end()) {
+				it = destinations.emplace(destination,State{}).first;
+			}
+
+			*key = &it->first;
+			State &state = it->second;
+
+			switch(state.state) {
+			case State::Closed:
+				break;
+
+			case State::Open:
+				if(std::chrono::steady_clock::now() - state.opened < interval) {
+					return false;
+				}
+				// This call is the probe.
+				state.state = State::HalfOpen;
+				state.opened = std::chrono::steady_clock::now();
+				Logger::String{"Probing '",destination,"'"}.trace(connection.name());
+				break;
+
+			case State::HalfOpen:
+				if(std::chrono::steady_clock::now() - state.opened < interval) {
+					// Wait for the probe.
+					return false;
+				}
+				// The probe is taking too long, send another one.
+				state.opened = std::chrono::steady_clock::now();
+				Logger::String{"Probing '",destination,"' again"}.trace(connection.name());
+				break;
+
+			}
+
+			state.calls++;
+
+			if(!state.watched) {
+				state.watched = true;
+				watch = true;
+			}
+		}
+
+		if(watch) {
+
+			// Not under the guard, the first watcher loads the name registry.
+			std::weak_ptr<CircuitBreaker> breaker = shared_from_this();
+			size_t id = 0;
+
+			try {
+				id = connection.watch_name(destination,[breaker](const char *name, const char *owner){
+					auto circuit = breaker.lock();
+					if(circuit && *owner) {
+						circuit->reset(name);
+					}
+				});
+			} catch(const std::exception &e) {
+				Logger::String{"Can't watch '",destination,"': ",e.what()}.warning(connection.name());
+			}
+
+			lock_guard<mutex> lock(guard);
+			State &state = destinations[destination];
+			state.watcher = id;
+			if(!id) {
+				// Try again on the next call.
+				state.watched = false;
+			}
+
+		}
+
+		return true;
+
+	}
+
+	void DBus::CircuitBreaker::record(const std::string *key, const char *error) noexcept {
+
+		if(!key) {
+			return;
+		}
+
+		// Only the errors saying the service is not there, any other reply means it's alive.
+		bool failed = error && (
+				strcmp(error,DBUS_ERROR_SERVICE_UNKNOWN) == 0
+				|| strcmp(error,DBUS_ERROR_NO_REPLY) == 0
+				|| strcmp(error,DBUS_ERROR_NAME_HAS_NO_OWNER) == 0
+			);
+
+		size_t watcher = 0;
+
+		{
+			lock_guard<mutex> lock(guard);
+
+			auto it = destinations.find(*key);
+			if(it == destinations.end()) {
+				return;
+			}
+
+			State &state = it->second;
+
+			if(!failed) {
+				if(state.state != State::Closed) {
+					Logger::String{"'",key->c_str(),"' is responding, closing circuit"}.info(name.c_str());
+				}
+				state.state = State::Closed;
+				state.failures = 0;
+			} else if(state.state == State::HalfOpen || ++state.failures >= threshold) {
+				if(state.state == State::Closed) {
+					Logger::String{"'",key->c_str(),"' is not responding, opening circuit"}.warning(name.c_str());
+				}
+				state.state = State::Open;
+				state.opened = std::chrono::steady_clock::now();
+			}
+
+			watcher = finish(it);
+		}
+
+		if(watcher) {
+			unwatch(watcher);
+		}
+
+	}
+
+	size_t DBus::CircuitBreaker::finish(std::unordered_map<std::string,State>::iterator it) noexcept {
+
+		State &state = it->second;
+
+		if(state.calls) {
+			state.calls--;
+		}
+
+		if(state.calls || state.state != State::Closed || state.failures) {
+			return 0;
+		}
+
+		// Nothing to remember, don't keep a state for every destination ever called.
+		size_t watcher = state.watcher;
+		destinations.erase(it);
+		return watcher;
+
+	}
+
+	void DBus::CircuitBreaker::cancel(const std::string *key) noexcept {
+
+		if(!key) {
+			return;
+		}
+
+		size_t watcher = 0;
+
+		{
+			lock_guard<mutex> lock(guard);
+
+			auto it = destinations.find(*key);
+			if(it == destinations.end()) {
+				return;
+			}
+
+			if(it->second.state == State::HalfOpen) {
+				// Not probed, the next call is the probe.
+				it->second.state = State::Open;
+				it->second.opened = std::chrono::steady_clock::now() - interval;
+			}
+
+			watcher = finish(it);
+		}
+
+		if(watcher) {
+			unwatch(watcher);
+		}
+
+	}
+
+	void DBus::CircuitBreaker::reset(const char *destination) noexcept {
+
+		lock_guard<mutex> lock(guard);
+
+		auto it = destinations.find(destination);
+		if(it != destinations.end()) {
+			it->second.state = State::Closed;
+			it->second.failures = 0;
+		}
+
+	}
+
+	void DBus::CircuitBreaker::set_error(DBusError *error, DBusMessage *message) {
+		dbus_set_error(error,error_name,"Circuit breaker is open for '%s'",dbus_message_get_destination(message));
+	}
+
+	void DBus::Connection::circuit_breaker(unsigned int failures, unsigned int interval) {
+
+		std::shared_ptr<CircuitBreaker> circuit;
+		if(failures) {
+			circuit = make_shared<CircuitBreaker>(*this,failures,interval);
+		}
+
+		// The previous one is released by the last pending call using it, remove the watchers now.
+		auto previous = std::atomic_exchange(&breaker,circuit);
+		if(previous) {
+			previous->unwatch();
+		}
+
+	}
+
+ }
+
@@ -23,136 +23,363 @@
  #include <udjat/tools/dbus/connection.h>
  #include <udjat/tools/dbus/message.h>
  #include <udjat/tools/dbus/exception.h>
+ #include <private/pending.h>
+ #include <private/breaker.h>
+ #include <private/deferred.h>
+ #include <mutex>
+ #include <memory>
+ #include <vector>
+ #include <system_error>
 
  using namespace std;
 
  namespace Udjat {
 
+	/// @brief Pool of pending call records, never released to the heap.
+	class DBus::PendingCall::Pool {
+	public:
+		std::mutex guard;
+		PendingCall *available = nullptr;
+		std::vector<std::unique_ptr<PendingCall[]>> blocks;
+		Statistics statistics;
+		bool enabled = true;
+
+		static Pool & getInstance() {
+			// Never destroyed, pending calls can be released after the static destructors.
+			static Pool *instance = new Pool();
+			return *instance;
+		}
+
+	};
+
+	DBus::PendingCall::Statistics DBus::PendingCall::statistics() noexcept {
+		Pool &pool = Pool::getInstance();
+		lock_guard<mutex> lock(pool.guard);
+		return pool.statistics;
+	}
+
+	void DBus::PendingCall::pooling(bool enable) noexcept {
+		Pool &pool = Pool::getInstance();
+		lock_guard<mutex> lock(pool.guard);
+		pool.enabled = enable;
+	}
 
-	/// @brief Parameters for method call.
-	struct CallParameters {
+	DBus::PendingCall * DBus::PendingCall::acquire() {
 
-		DBusConnection * connection = nullptr;
-		const std::function<void(DBus::Message &)> call;
+		Pool &pool = Pool::getInstance();
+		lock_guard<mutex> lock(pool.guard);
 
-		CallParameters(DBus::Connection *c, const std::function<void(DBus::Message &)> &f) : connection(c->connection()), call(f) {
-			Logger::trace() << "New call parameters " << hex << ((void *) this) << dec << endl;
-			dbus_connection_ref(connection);
+		if(!pool.enabled) {
+			pool.statistics.acquired++;
+			return new PendingCall();
 		}
 
-		~CallParameters() {
-			Logger::trace() << "Delete call parameters " << hex << ((void *) this) << dec << endl;
-			dbus_connection_unref(connection);
+		if(!pool.available) {
+			static constexpr size_t block = 256;
+			PendingCall *records = new PendingCall[block];
+			pool.blocks.emplace_back(records);
+			for(size_t ix = 0; ix < block; ix++) {
+				records[ix].pooled = true;
+				records[ix].next = pool.available;
+				pool.available = records+ix;
+			}
+			pool.statistics.records += block;
+			pool.statistics.available += block;
 		}
 
-	};
+		PendingCall *record = pool.available;
+		pool.available = record->next;
+		record->next = nullptr;
+		pool.statistics.available--;
+		pool.statistics.acquired++;
+		return record;
 
-	static void dbus_call_reply(DBusPendingCall *pending, CallParameters *parameters) {
+	}
 
-		debug("Got a reply from pending call");
+	/// @brief Update the circuit breaker with the call result.
+	static inline void report(DBus::PendingCall *parameters, const char *error) noexcept {
+		if(parameters->breaker) {
+			parameters->breaker->record(parameters->destination,error);
+			parameters->breaker.reset();
+		}
+	}
 
-		DBusError error;
-		dbus_error_init(&error);
+	/// @brief Send the reply to a pending call record.
+	static void deliver(DBus::PendingCall *record, DBusMessage *message, const DBusError &error) noexcept {
 
-		if(!dbus_pending_call_get_completed(pending)) {
+		try {
 
-			// NO response
+			// Nested calls from the callback share the caller's deadline.
+			DBus::Deadline scope{record->deadline};
 
-			debug("No response from d-bus call");
+			if(message) {
+				DBus::Message response{message};
+				(*record)(response);
+			} else {
+				DBus::Message response{error};
+				(*record)(response);
+			}
+
+		} catch(std::exception &e) {
+
+			cerr << "dbus\tCan't process response: " << e.what() << endl;
 
-			dbus_set_error_const(&error, "Unexpected", "Failed to get pending reply");
-			DBus::Message message(error);
+		} catch(...) {
+
+			cerr << "dbus\tUnexpected error processing response" << endl;
+
+		}
+
+	}
+
+	static void dbus_call_reply(DBusPendingCall *pending, DBus::PendingCall *parameters);
+
+	/// @brief Send method call, the record is released by libdbus with the pending call.
+	static void send_with_reply(DBusConnection *conn, DBusMessage *message, DBus::PendingCall *record, int timeout) {
+
+		DBusPendingCall *pending = NULL;
+
+		if(!conn) {
+			throw logic_error("Connection is not available");
+		}
+
+		// Local errors aren't reported to the circuit breaker, the call never reached the destination.
+		{
+			// Queued calls keep the deadline from the caller.
+			DBus::Deadline scope{record->deadline};
+
+			if(!dbus_connection_send_with_reply(conn,message,&pending,DBus::Deadline::timeout(timeout))) {
+				throw std::runtime_error("Can't send DBus method call");
+			}
+		}
+
+		if(!pending) {
+			throw std::runtime_error("Invalid 'pending call' handler");
+		}
+
+		if(!dbus_pending_call_set_notify(pending, (DBusPendingCallNotifyFunction) dbus_call_reply, (void *) record, (DBusFreeFunction) DBus::PendingCall::release)) {
+			dbus_pending_call_cancel(pending);
+			dbus_pending_call_unref(pending);
+			throw std::runtime_error("Can't set call notify function");
+		}
+
+		dbus_pending_call_unref(pending);
+
+	}
+
+	/// @brief Send the calls waiting for a released slot.
+	static void drain(const std::shared_ptr<DBus::Throttle> &throttle, DBus::Throttle::Lane *lane) noexcept {
+
+		DBus::Throttle::Queued entry;
+
+		while(throttle->next(lane,entry)) {
+
+			std::string reason;
 
 			try {
 
-				parameters->call(message);
+				send_with_reply(entry.conn,entry.message,entry.record,entry.timeout);
 
-			} catch(std::exception &e) {
+			} catch(const std::exception &e) {
 
-				cerr << "dbus\tCan't process error message: " << e.what() << endl;
+				reason = e.what();
 
 			} catch(...) {
 
-				cerr << "dbus\tUnexpected error processing error message" << endl;
+				reason = "Unexpected error sending queued call";
 
 			}
 
-			dbus_pending_call_cancel(pending);
+			dbus_message_unref(entry.message);
+			dbus_connection_unref(entry.conn);
 
-		} else {
+			if(reason.empty()) {
+				return;
+			}
 
-			// Got response
-			DBusMessage * message = dbus_pending_call_steal_reply(pending);
+			// Not sent, the slot goes to the next one.
+			entry.record->throttle.reset();
+			entry.record->lane = nullptr;
 
-			if(message) {
+			DBus::PendingCall::fail(entry.record,DBUS_ERROR_NO_REPLY,reason.c_str());
 
-				debug("Got response from dbus call");
+		}
 
-				try {
+	}
 
-					DBus::Message msg{message};
-					parameters->call(msg);
+	void DBus::PendingCall::fail(PendingCall *record, const char *name, const char *message) noexcept {
 
-				} catch(std::exception &e) {
+		DBusError error;
+		dbus_error_init(&error);
+		dbus_set_error(&error, name, "%s", message);
+		deliver(record,nullptr,error);
+		dbus_error_free(&error);
 
-					cerr << "dbus\tCan't process error message: " << e.what() << endl;
+		release(record);
 
-				} catch(...) {
+	}
 
-					cerr << "dbus\tUnexpected error processing error message" << endl;
+	void DBus::PendingCall::release(PendingCall *record) noexcept {
 
+		if(record->flight) {
+
+			// Never answered, don't leave the identical calls waiting.
+			auto followers = record->flight->land();
+			record->flight.reset();
+
+			if(!followers.empty()) {
+				DBusError error;
+				dbus_error_init(&error);
+				dbus_set_error_const(&error, DBUS_ERROR_NO_REPLY, "The shared call was cancelled");
+				for(auto follower : followers) {
+					// Never sent, release() gives its circuit breaker slot back.
+					deliver(follower,nullptr,error);
+					release(follower);
 				}
+				dbus_error_free(&error);
+			}
 
-				dbus_message_unref(message);
+		}
 
-			} else {
+		std::shared_ptr<Throttle> throttle;
+		throttle.swap(record->throttle);
+		Throttle::Lane *lane = record->lane;
+		record->lane = nullptr;
 
-				debug("Empty response from dbus call");
-				dbus_set_error_const(&error, "empty", "No response");
+		// Released without a result, don't leave the circuit waiting for the probe.
+		if(record->breaker) {
+			record->breaker->cancel(record->destination);
+			record->breaker.reset();
+		}
+
+		// The callback destructor can send new calls, run it without the lock.
+		record->reset();
+		record->destination = nullptr;
+
+		if(!record->pooled) {
+			delete record;
+		} else {
+			Pool &pool = Pool::getInstance();
+			lock_guard<mutex> lock(pool.guard);
+			record->next = pool.available;
+			pool.available = record;
+			pool.statistics.available++;
+		}
 
-				try {
+		if(throttle) {
+			drain(throttle,lane);
+		}
 
-					DBus::Message msg(error);
-					parameters->call(msg);
+	}
 
-				} catch(std::exception &e) {
+	static void dbus_call_reply(DBusPendingCall *pending, DBus::PendingCall *parameters) {
 
-					cerr << "dbus\tCan't process error message: " << e.what() << endl;
+		debug("Got a reply from pending call");
 
-				} catch(...) {
+		DBusError error;
+		dbus_error_init(&error);
 
-					cerr << "dbus\tUnexpected error processing error message" << endl;
+		DBusMessage * message = nullptr;
+		bool completed = dbus_pending_call_get_completed(pending);
 
-				}
+		if(!completed) {
 
+			// NO response
+			debug("No response from d-bus call");
+			dbus_set_error_const(&error, DBUS_ERROR_FAILED, "Failed to get pending reply");
+
+		} else {
+
+			// Got response
+			message = dbus_pending_call_steal_reply(pending);
+
+			if(!message) {
+				debug("Empty response from dbus call");
+				dbus_set_error_const(&error, DBUS_ERROR_NO_REPLY, "No response");
 			}
 
 		}
 
+		report(parameters,message ? dbus_message_get_error_name(message) : DBUS_ERROR_NO_REPLY);
+
+		// Identical calls waiting for this reply.
+		std::vector<DBus::PendingCall *> followers;
+		if(parameters->flight) {
+			followers = parameters->flight->land();
+			parameters->flight.reset();
+		}
+
+		deliver(parameters,message,error);
+
+		for(auto follower : followers) {
+			// Never sent, release() gives its circuit breaker slot back; only the leader counts.
+			deliver(follower,message,error);
+			DBus::PendingCall::release(follower);
+		}
+
+		if(message) {
+			dbus_message_unref(message);
+		}
+
+		if(!completed) {
+			dbus_pending_call_cancel(pending);
+		}
+
 		dbus_error_free(&error);
 
 	}
 
+	void DBus::Connection::check_fds(DBusMessage *message) const {
+		if(conn && dbus_message_contains_unix_fds(message) && !dbus_connection_can_send_type(conn,DBUS_TYPE_UNIX_FD)) {
+			throw system_error(ENOTSUP,system_category(),"This connection can't pass file descriptors");
+		}
+	}
+
+	bool DBus::Connection::can_send_type(int type) const noexcept {
+		return conn && dbus_connection_can_send_type(conn,type);
+	}
+
 	void DBus::Connection::call(DBusMessage * message) {
+		call(message,DBUS_TIMEOUT_USE_DEFAULT);
+	}
+
+	void DBus::Connection::call(DBusMessage * message, int timeout) {
 
 		if(!conn) {
 			throw logic_error("Connection is not available");
 		}
 
+		check_fds(message);
+
 		DBus::Error error;
 
 		switch(dbus_message_get_type(message)) {
 		case DBUS_MESSAGE_TYPE_METHOD_CALL:
 			{
+				// Before admit(), an expired deadline throws without a result to record.
+				int milliseconds = Deadline::timeout(timeout);
+
+				const std::string *key = nullptr;
+				auto circuit = std::atomic_load(&breaker);
+				if(circuit && !circuit->admit(message,&key)) {
+					// Fail fast, without touching the bus.
+					CircuitBreaker::set_error(error,message);
+					break;
+				}
+
 				debug("Sending method call...");
 				DBusMessage * response =
 					dbus_connection_send_with_reply_and_block(
 						conn,
 						message,
-						DBUS_TIMEOUT_USE_DEFAULT,
+						milliseconds,
 						error
 					);
 
+				if(circuit) {
+					circuit->record(key,dbus_error_is_set(error) ? ((DBusError *) error)->name : nullptr);
+				}
+
 				if(response) {
 					dbus_message_unref(response);
 				}
@@ -178,25 +405,48 @@
 	}
 
 	void DBus::Connection::call_and_wait(DBusMessage * message, const std::function<void(Udjat::DBus::Message & message)> &call) {
+		call_and_wait(message,call,DBUS_TIMEOUT_USE_DEFAULT);
+	}
+
+	void DBus::Connection::call_and_wait(DBusMessage * message, const std::function<void(Udjat::DBus::Message & message)> &call, int timeout) {
 
 		if(!conn) {
 			throw logic_error("Connection is not available");
 		}
 
+		check_fds(message);
+
 		DBusError error;
 		dbus_error_init(&error);
 
-		debug("Calling and waiting...");
-		
-		DBusMessage * response =
-			dbus_connection_send_with_reply_and_block(
-				conn,
-				message,
-				DBUS_TIMEOUT_USE_DEFAULT,
-				&error
-			);
+		timeout = Deadline::timeout(timeout);
 
+		DBusMessage * response = nullptr;
+		const std::string *key = nullptr;
+		auto circuit = std::atomic_load(&breaker);
 
+		if(circuit && !circuit->admit(message,&key)) {
+
+			// Fail fast, without touching the bus.
+			CircuitBreaker::set_error(&error,message);
+
+		} else {
+
+			debug("Calling and waiting...");
+
+			response =
+				dbus_connection_send_with_reply_and_block(
+					conn,
+					message,
+					timeout,
+					&error
+				);
+
+			if(circuit) {
+				circuit->record(key,dbus_error_is_set(&error) ? error.name : nullptr);
+			}
+
+		}
 
 		if(dbus_error_is_set(&error)) {
 
@@ -236,60 +486,98 @@
 
 	}
 
-	void free_parameters(CallParameters *parameters) {
-		debug("Cleaning pending call");
-		delete parameters;
+	void DBus::Connection::call(DBusMessage * message, const std::function<void(Udjat::DBus::Message & message)> &call) {
+		this->call(message,call,DBUS_TIMEOUT_USE_DEFAULT);
 	}
 
-	void DBus::Connection::call(DBusMessage * message, const std::function<void(Udjat::DBus::Message & message)> &call) {
+	void DBus::Connection::call(DBusMessage * message, const std::function<void(Udjat::DBus::Message & message)> &call, int timeout) {
+		PendingCall *record = PendingCall::acquire();
+		try {
+			record->emplace(call);
+		} catch(...) {
+			PendingCall::release(record);
+			throw;
+		}
+		send(message,record,timeout);
+	}
 
-		if(!conn) {
-			throw logic_error("Connection is not available");
+	void DBus::Connection::send(DBusMessage * message, PendingCall *record, int timeout) {
+
+		try {
+			check_fds(message);
+		} catch(...) {
+			PendingCall::release(record);
+			throw;
 		}
 
-		debug("----------------------------------- pending call");
+		const std::string *key = nullptr;
+		auto circuit = std::atomic_load(&breaker);
 
-		DBusPendingCall *pending = NULL;
+		record->deadline = Deadline::limit();
 
-		if(!dbus_connection_send_with_reply(conn,message,&pending,DBUS_TIMEOUT_USE_DEFAULT)) {
-			throw std::runtime_error("Can't send DBus method call");
-		}
+		if(circuit && !circuit->admit(message,&key)) {
 
-		if(!pending) {
-			throw std::runtime_error("Invalid 'pending call' handler");
+			// Fail fast, without touching the bus; from the main loop, like a reply.
+			std::string text;
+			{
+				DBusError error;
+				dbus_error_init(&error);
+				CircuitBreaker::set_error(&error,message);
+				text = error.message;
+				dbus_error_free(&error);
+			}
+
+			Deferred::getInstance().push_back([record,text](){
+				PendingCall::fail(record,CircuitBreaker::error_name,text.c_str());
+			});
 			return;
+
 		}
 
-		CallParameters *parameters = new CallParameters(this,call);
+		if(key) {
+			record->breaker = circuit;
+			record->destination = key;
+		}
 
-		static dbus_int32_t slot = -1;
-		if(slot == -1) {
-			if(!dbus_pending_call_allocate_data_slot(&slot)) {
-				throw std::runtime_error("Cant allocate pending call data slot");
+		{
+			auto table = std::atomic_load(&flights);
+			if(table && table->join(message,record)) {
+				// Identical call in flight, wait for its reply.
+				return;
 			}
 		}
 
-		dbus_pending_call_set_data(pending,slot,parameters,(DBusFreeFunction) free_parameters);
-
-		if(!dbus_pending_call_set_notify(pending, (DBusPendingCallNotifyFunction) dbus_call_reply, (void *) parameters, NULL)) {
-			dbus_pending_call_unref(pending);
-			dbus_message_unref(message);
-			delete parameters;
-			throw std::runtime_error("Can't set call notify function");
+		{
+			auto limiter = std::atomic_load(&throttle);
+			if(conn && limiter && !limiter->acquire(conn,message,record,timeout)) {
+				// Too many calls in flight to the destination, sent when one of them is answered.
+				return;
+			}
 		}
 
-		dbus_pending_call_unref(pending);
-
-		debug("------------------------------------ Pending call was set");
+		try {
+			send_with_reply(conn,message,record,timeout);
+		} catch(...) {
+			PendingCall::release(record);
+			throw;
+		}
 
 	}
 
 	void DBus::Connection::get(const char *destination, const char *path, const char *interface, const char *property_name, const std::function<void(Udjat::DBus::Message & message)> &call) {
+		get(destination,path,interface,property_name,call,DBUS_TIMEOUT_USE_DEFAULT);
+	}
+
+	void DBus::Connection::get(const char *destination, const char *path, const char *interface, const char *property_name, const std::function<void(Udjat::DBus::Message & message)> &call, int timeout) {
 
 		if(!conn) {
 			throw logic_error("Connection is not available");
 		}
 
+		if(get_cached(destination,path,interface,property_name,call,timeout)) {
+			return;
+		}
+
 		DBusMessage * message = dbus_message_new_method_call(destination,path,"org.freedesktop.DBus.Properties","Get");
 		if(message == NULL) {
 			throw std::runtime_error("Error creating DBus method call");
@@ -308,7 +596,7 @@
 		}
 
 		try {
-			this->call(message,call);
+			this->call(message,call,timeout);
 		} catch(...) {
 			dbus_message_unref(message);
 			throw;
@@ -319,6 +607,10 @@
 	}
 
 	void DBus::Connection::call(const char *destination,const char *path, const char *interface, const char *member, const std::function<void(Udjat::DBus::Message & message)> &call) {
+		this->call(destination,path,interface,member,call,DBUS_TIMEOUT_USE_DEFAULT);
+	}
+
+	void DBus::Connection::call(const char *destination,const char *path, const char *interface, const char *member, const std::function<void(Udjat::DBus::Message & message)> &call, int timeout) {
 
 		if(!conn) {
 			throw logic_error("Connection is not available");
@@ -330,7 +622,7 @@
 		}
 
 		try {
-			this->call(message,call);
+			this->call(message,call,timeout);
 		} catch(...) {
 			dbus_message_unref(message);
 			throw;
@@ -341,10 +633,18 @@
 	}
 
 	void DBus::Connection::call(const Udjat::DBus::Message & request,const std::function<void(Udjat::DBus::Message & response)> &call) {
-		this->call((DBusMessage *)request,call);
+		this->call((DBusMessage *)request,call,DBUS_TIMEOUT_USE_DEFAULT);
+	}
+
+	void DBus::Connection::call(const Udjat::DBus::Message & request,const std::function<void(Udjat::DBus::Message & response)> &call, int timeout) {
+		this->call((DBusMessage *)request,call,timeout);
 	}
 
 	void DBus::Connection::call_and_wait(const char *destination,const char *path, const char *interface, const char *member, const std::function<void(Udjat::DBus::Message & message)> &call) {
+		call_and_wait(destination,path,interface,member,call,DBUS_TIMEOUT_USE_DEFAULT);
+	}
+
+	void DBus::Connection::call_and_wait(const char *destination,const char *path, const char *interface, const char *member, const std::function<void(Udjat::DBus::Message & message)> &call, int timeout) {
 
 		if(!conn) {
 			throw logic_error("Connection is not available");
@@ -356,7 +656,7 @@
 		}
 
 		try {
-			this->call_and_wait(message,call);
+			this->call_and_wait(message,call,timeout);
 		} catch(...) {
 			dbus_message_unref(message);
 			throw;
@@ -367,7 +667,11 @@
 	}
 
 	void DBus::Connection::call_and_wait(const Udjat::DBus::Message & request,const std::function<void(Udjat::DBus::Message & response)> &call) {
-		this->call_and_wait((DBusMessage *)request,call);
+		call_and_wait((DBusMessage *)request,call,DBUS_TIMEOUT_USE_DEFAULT);
+	}
+
+	void DBus::Connection::call_and_wait(const Udjat::DBus::Message & request,const std::function<void(Udjat::DBus::Message & response)> &call, int timeout) {
+		this->call_and_wait((DBusMessage *)request,call,timeout);
 	}
 
  }
@@ -0,0 +1,99 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+ /**
+  * @brief Implements d-bus call deadlines.
+  */
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <udjat/tools/dbus/deadline.h>
+ #include <system_error>
+ #include <algorithm>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	static thread_local DBus::Deadline *active = nullptr;
+
+	DBus::Deadline::Deadline(int milliseconds) : Deadline{std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds)} {
+	}
+
+	DBus::Deadline::Deadline(const TimePoint &limit) : value{limit}, parent{active} {
+		if(parent && parent->value < value) {
+			value = parent->value;
+		}
+		active = this;
+	}
+
+	DBus::Deadline::~Deadline() {
+		active = parent;
+	}
+
+	DBus::Deadline::TimePoint DBus::Deadline::limit() noexcept {
+		if(active) {
+			return active->value;
+		}
+		return TimePoint::max();
+	}
+
+	int DBus::Deadline::remaining() const noexcept {
+
+		if(value == TimePoint::max()) {
+			return DBUS_TIMEOUT_INFINITE;
+		}
+
+		auto now = std::chrono::steady_clock::now();
+		if(value <= now) {
+			return 0;
+		}
+
+		// Round up, don't report 0 before expiration.
+		auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(value - now + std::chrono::microseconds(999)).count();
+		if(milliseconds > DBUS_TIMEOUT_INFINITE) {
+			return DBUS_TIMEOUT_INFINITE;
+		}
+
+		return (int) milliseconds;
+
+	}
+
+	int DBus::Deadline::timeout(int milliseconds) {
+
+		if(!active || active->value == TimePoint::max()) {
+			return milliseconds;
+		}
+
+		int remaining = active->remaining();
+		if(!remaining) {
+			throw system_error(ETIMEDOUT,system_category(),"The d-bus call deadline has expired");
+		}
+
+		if(milliseconds < 0) {
+			milliseconds = default_timeout;
+		}
+
+		return std::min(milliseconds,remaining);
+
+	}
+
+ }
+
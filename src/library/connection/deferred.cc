@@ -0,0 +1,81 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+ /**
+  * @brief Implements the queue of callbacks delivered from the main loop.
+  */
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <private/deferred.h>
+ #include <udjat/tools/mainloop.h>
+ #include <udjat/tools/logger.h>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	DBus::Deferred & DBus::Deferred::getInstance() {
+		static Deferred instance;
+		return instance;
+	}
+
+	DBus::Deferred::~Deferred() {
+		disable();
+	}
+
+	void DBus::Deferred::on_timer() {
+
+		disable();
+
+		decltype(pending) callbacks;
+		{
+			lock_guard<mutex> lock(guard);
+			callbacks.swap(pending);
+		}
+
+		for(auto &callback : callbacks) {
+			try {
+				callback();
+			} catch(const std::exception &e) {
+				Logger::String{"Error on deferred d-bus callback: ",e.what()}.error("d-bus");
+			} catch(...) {
+				Logger::String{"Unexpected error on deferred d-bus callback"}.error("d-bus");
+			}
+		}
+
+	}
+
+	void DBus::Deferred::push_back(std::function<void()> callback) {
+
+		{
+			lock_guard<mutex> lock(guard);
+			pending.push_back(std::move(callback));
+			if(pending.size() > 1) {
+				// Already scheduled.
+				return;
+			}
+		}
+
+		reset(0);
+		enable();
+		MainLoop::getInstance().wakeup();
+
+	}
+
+ }
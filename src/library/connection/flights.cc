@@ -0,0 +1,161 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+ /**
+  * @brief Implements the single-flight table.
+  */
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <udjat/tools/dbus/connection.h>
+ #include <private/pending.h>
+ #include <private/flights.h>
+ #include <cstring>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	static thread_local size_t scopes = 0;
+
+	DBus::Connection::SingleFlight::SingleFlight() {
+		scopes++;
+	}
+
+	DBus::Connection::SingleFlight::~SingleFlight() {
+		scopes--;
+	}
+
+	bool DBus::Connection::SingleFlight::active() noexcept {
+		return scopes != 0;
+	}
+
+	std::string DBus::Flights::KeyFactory(DBusMessage *message) {
+
+		if(dbus_message_get_type(message) != DBUS_MESSAGE_TYPE_METHOD_CALL || dbus_message_get_no_reply(message)) {
+			return std::string{};
+		}
+
+		// The descriptors aren't in the marshalled data, calls passing them are never identical.
+		if(dbus_message_contains_unix_fds(message)) {
+			return std::string{};
+		}
+
+		// Don't share the bus calls, AddMatch/RemoveMatch have side effects.
+		const char *destination = dbus_message_get_destination(message);
+		if(!destination || !strcmp(destination,DBUS_SERVICE_DBUS)) {
+			return std::string{};
+		}
+
+		// The marshalled message has the header fields and the arguments.
+		char *data = nullptr;
+		int length = 0;
+		if(!dbus_message_marshal(message,&data,&length)) {
+			return std::string{};
+		}
+
+		std::string key{data,(size_t) length};
+		dbus_free(data);
+
+		// Ignore the serial, it changes on every send.
+		if(key.size() > 12) {
+			memset(&key[8],0,4);
+		}
+
+		return key;
+
+	}
+
+	bool DBus::Flights::join(DBusMessage *message, PendingCall *record) {
+
+		if(!Connection::SingleFlight::active()) {
+			return false;
+		}
+
+		std::string key{KeyFactory(message)};
+		if(key.empty()) {
+			return false;
+		}
+
+		lock_guard<mutex> lock(guard);
+
+		auto it = flights.find(key);
+		if(it != flights.end()) {
+			it->second->followers.push_back(record);
+			joined++;
+			return true;
+		}
+
+		auto flight = make_shared<Flight>();
+		flight->table = shared_from_this();
+		flight->key = key;
+		flights.emplace(std::move(key),flight);
+		record->flight = flight;
+		sent++;
+
+		return false;
+
+	}
+
+	void DBus::Flights::statistics(size_t &s, size_t &j) noexcept {
+		lock_guard<mutex> lock(guard);
+		s = sent;
+		j = joined;
+	}
+
+	std::vector<DBus::PendingCall *> DBus::Flights::Flight::land() {
+
+		std::vector<PendingCall *> records;
+
+		std::shared_ptr<Flights> owner;
+		owner.swap(table);
+
+		if(owner) {
+			lock_guard<mutex> lock(owner->guard);
+			auto it = owner->flights.find(key);
+			if(it != owner->flights.end() && it->second.get() == this) {
+				owner->flights.erase(it);
+			}
+			records.swap(followers);
+		}
+
+		return records;
+
+	}
+
+	void DBus::Connection::single_flight(bool enable) {
+		std::atomic_store(&flights,enable ? make_shared<Flights>() : std::shared_ptr<Flights>{});
+	}
+
+	DBus::Connection::FlightStatistics DBus::Connection::single_flight_statistics() const noexcept {
+
+		FlightStatistics statistics;
+
+		auto table = std::atomic_load(&flights);
+		if(table) {
+			table->statistics(statistics.sent,statistics.joined);
+		}
+
+		return statistics;
+
+	}
+
+ }
+
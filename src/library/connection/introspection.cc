@@ -0,0 +1,232 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+ /**
+  * @brief Implements the introspection cache.
+  */
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <udjat/tools/dbus/connection.h>
+ #include <udjat/tools/dbus/message.h>
+ #include <udjat/tools/dbus/introspection.h>
+ #include <udjat/tools/logger.h>
+ #include <pugixml.hpp>
+ #include <cstring>
+ #include <string>
+ #include <unordered_map>
+ #include <mutex>
+ #include <memory>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	DBus::Introspection::Introspection(const char *xml) {
+
+		pugi::xml_document document;
+		auto result = document.load_string(xml);
+		if(!result) {
+			throw runtime_error(String{"Invalid introspection data: ",result.description()});
+		}
+
+		for(auto node : document.child("node").children("interface")) {
+
+			Interface &interface = interfaces[node.attribute("name").as_string()];
+
+			for(auto child : node.children("method")) {
+
+				Method &method = interface.methods[child.attribute("name").as_string()];
+
+				for(auto arg : child.children("arg")) {
+
+					Argument argument{arg.attribute("name").as_string(),arg.attribute("type").as_string()};
+
+					// Method arguments are input by default.
+					if(strcmp(arg.attribute("direction").as_string("in"),"out") == 0) {
+						method.output.push_back(argument);
+					} else {
+						method.input.push_back(argument);
+					}
+
+				}
+
+			}
+
+			for(auto child : node.children("property")) {
+				Property &property = interface.properties[child.attribute("name").as_string()];
+				property.signature = child.attribute("type").as_string();
+				const char *access = child.attribute("access").as_string("read");
+				property.readable = strstr(access,"read") != nullptr;
+				property.writable = strstr(access,"write") != nullptr;
+			}
+
+		}
+
+	}
+
+	const DBus::Introspection::Method * DBus::Introspection::method(const char *interface, const char *name) const noexcept {
+
+		auto intf = interfaces.find(interface);
+		if(intf == interfaces.end()) {
+			return nullptr;
+		}
+
+		auto it = intf->second.methods.find(name);
+		if(it == intf->second.methods.end()) {
+			return nullptr;
+		}
+
+		return &it->second;
+
+	}
+
+	const DBus::Introspection::Property * DBus::Introspection::property(const char *interface, const char *name) const noexcept {
+
+		auto intf = interfaces.find(interface);
+		if(intf == interfaces.end()) {
+			return nullptr;
+		}
+
+		auto it = intf->second.properties.find(name);
+		if(it == intf->second.properties.end()) {
+			return nullptr;
+		}
+
+		return &it->second;
+
+	}
+
+	/// @brief Introspection data by (destination, path), dropped when the destination owner changes.
+	class DBus::Connection::Introspections {
+	public:
+		std::mutex guard;
+
+		std::unordered_map<std::string,std::shared_ptr<const Introspection>> objects;
+
+		/// @brief Owner watcher for every destination.
+		std::unordered_map<std::string,size_t> watchers;
+
+		static inline std::string key(const char *destination, const char *path) {
+			return std::string{destination} + '\n' + path;
+		}
+
+		void reset(const std::string &destination) {
+			std::string prefix{destination + '\n'};
+			lock_guard<mutex> lock(guard);
+			for(auto it = objects.begin(); it != objects.end();) {
+				if(it->first.compare(0,prefix.size(),prefix) == 0) {
+					it = objects.erase(it);
+				} else {
+					it++;
+				}
+			}
+		}
+
+	};
+
+	std::shared_ptr<const DBus::Introspection> DBus::Connection::introspect(const char *destination, const char *path, int timeout) {
+
+		std::shared_ptr<Introspections> cache;
+		{
+			lock_guard<mutex> lock(guard);
+			if(!introspections) {
+				introspections = make_shared<Introspections>();
+			}
+			cache = introspections;
+		}
+
+		std::string key{Introspections::key(destination,path)};
+		bool watch;
+
+		{
+			lock_guard<mutex> lock(cache->guard);
+			auto it = cache->objects.find(key);
+			if(it != cache->objects.end()) {
+				return it->second;
+			}
+			watch = (cache->watchers.find(destination) == cache->watchers.end());
+		}
+
+		if(watch) {
+
+			// Drop the objects when the service restarts, before asking for them.
+			std::weak_ptr<Introspections> introspections = cache;
+			size_t id = watch_name(destination,[introspections](const char *name, const char *){
+				auto cache = introspections.lock();
+				if(cache) {
+					cache->reset(name);
+				}
+			});
+
+			lock_guard<mutex> lock(cache->guard);
+			if(!cache->watchers.emplace(destination,id).second) {
+				unwatch_name(id);
+			}
+
+		}
+
+		std::shared_ptr<const Introspection> introspection;
+		std::string error;
+
+		call_and_wait(
+			DBus::Message{destination,path,DBUS_INTERFACE_INTROSPECTABLE,"Introspect"},
+			[&introspection,&error](Message &response){
+
+				if(response.failed()) {
+					if(strcmp(response.error_name(),DBUS_ERROR_NO_REPLY) && strcmp(response.error_name(),DBUS_ERROR_DISCONNECTED)) {
+						// The object answered, the error will not change until the owner does.
+						error = response.error_name();
+						error += ": ";
+						error += response.error_message();
+						return;
+					}
+					response.except();
+				}
+
+				std::string xml;
+				response.pop(xml);
+				introspection = make_shared<const Introspection>(xml.c_str());
+
+			},
+			timeout
+		);
+
+		if(!introspection) {
+
+			if(error.empty()) {
+				throw runtime_error("No response from Introspect");
+			}
+
+			// Remember the error as an object without interfaces; only this call reports it.
+			lock_guard<mutex> lock(cache->guard);
+			cache->objects[key] = make_shared<const Introspection>("<node/>");
+			throw runtime_error(error);
+
+		}
+
+		lock_guard<mutex> lock(cache->guard);
+		cache->objects[key] = introspection;
+		return introspection;
+
+	}
+
+ }
+
@@ -0,0 +1,228 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+ /**
+  * @brief Implements batched match rule registration.
+  */
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <string>
+ #include <vector>
+ #include <unordered_map>
+ #include <mutex>
+ #include <algorithm>
+ #include <udjat/tools/dbus/connection.h>
+ #include <udjat/tools/dbus/message.h>
+ #include <private/pending.h>
+ #include <udjat/tools/logger.h>
+ #include <udjat/tools/mainloop.h>
+ #include <udjat/tools/timer.h>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	/// @brief Match rules waiting for the next batch.
+	class DBus::Connection::Rules : public MainLoop::Timer {
+	private:
+		DBus::Connection &connection;
+
+	protected:
+		void on_timer() override {
+			disable();
+			try {
+				connection.commit();
+			} catch(const std::exception &e) {
+				Logger::String{"Error sending match rules: ",e.what()}.error(connection.name());
+			}
+		}
+
+	public:
+
+		/// @brief Time to wait for more rules before sending the batch.
+		static constexpr unsigned long interval = 10;
+
+		/// @brief Rules not yet sent to the bus.
+		std::vector<std::string> pending;
+
+		/// @brief Reference count for every rule, members with the same constraints share them.
+		std::unordered_map<std::string,size_t> active;
+
+		/// @brief Method to call when the bus rejects a rule.
+		std::function<void(const char *rule, const char *message)> on_error;
+
+		Rules(DBus::Connection &c) : connection{c} {
+			on_error = [this](const char *rule, const char *message) {
+				Logger::String{"Error '",message,"' adding rule ",rule}.error(connection.name());
+			};
+		}
+
+		virtual ~Rules() {
+			disable();
+		}
+
+		/// @brief Queue rule, schedule the batch if it's the first one.
+		void push_back(const char *rule) {
+			pending.emplace_back(rule);
+			if(pending.size() == 1) {
+				reset(interval);
+				enable();
+			}
+		}
+
+	};
+
+	void DBus::Connection::add_match(const char *rule) {
+
+		if(!rules) {
+			rules = make_shared<Rules>(*this);
+		}
+
+		if(rules->active[rule]++) {
+			// Already registered.
+			return;
+		}
+
+		Logger::String{"Connecting to '",rule,"'"}.trace(name());
+		rules->push_back(rule);
+
+	}
+
+	void DBus::Connection::remove_match(const char *rule) {
+
+		if(!rules) {
+			return;
+		}
+
+		{
+			auto it = rules->active.find(rule);
+			if(it == rules->active.end() || --it->second) {
+				// Unknown or still in use.
+				return;
+			}
+			rules->active.erase(it);
+		}
+
+		Logger::String{"Disconnecting from '",rule,"'"}.trace(name());
+
+		{
+			// Not sent yet? Just forget it.
+			auto it = std::find(rules->pending.begin(),rules->pending.end(),rule);
+			if(it != rules->pending.end()) {
+				rules->pending.erase(it);
+				return;
+			}
+		}
+
+		// Without an error pointer libdbus doesn't wait for the reply.
+		dbus_bus_remove_match(conn,rule,NULL);
+
+	}
+
+	void DBus::Connection::on_match_error(const std::function<void(const char *rule, const char *message)> &callback) {
+
+		lock_guard<mutex> lock(guard);
+
+		if(!rules) {
+			rules = make_shared<Rules>(*this);
+		}
+
+		rules->on_error = callback;
+
+	}
+
+	void DBus::Connection::commit() {
+
+		std::vector<std::string> batch;
+		std::function<void(const char *rule, const char *message)> on_error;
+
+		{
+			lock_guard<mutex> lock(guard);
+			if(!(rules && !rules->pending.empty())) {
+				return;
+			}
+			batch.swap(rules->pending);
+			on_error = rules->on_error;
+			rules->disable();
+		}
+
+		Logger::String{"Sending ",batch.size()," match rule(s)"}.trace(name());
+
+		size_t sent = 0;
+
+		try {
+
+			for(const auto &rule : batch) {
+
+				DBusMessage *message = dbus_message_new_method_call(
+					DBUS_SERVICE_DBUS,
+					DBUS_PATH_DBUS,
+					DBUS_INTERFACE_DBUS,
+					"AddMatch"
+				);
+
+				if(!message) {
+					throw std::runtime_error("Error creating DBus method call");
+				}
+
+				const char *str = rule.c_str();
+				if(!dbus_message_append_args(message,DBUS_TYPE_STRING,&str,DBUS_TYPE_INVALID)) {
+					dbus_message_unref(message);
+					throw std::runtime_error("Error appending arguments to DBus method call");
+				}
+
+				// The reply is checked later, from the main loop.
+				try {
+					PendingCall *record = PendingCall::acquire();
+					record->emplace([rule,on_error](Message &response){
+						if(response.failed()) {
+							on_error(rule.c_str(),response.error_message());
+						}
+					});
+					send(message,record,DBUS_TIMEOUT_USE_DEFAULT);
+				} catch(...) {
+					dbus_message_unref(message);
+					throw;
+				}
+
+				dbus_message_unref(message);
+				sent++;
+
+			}
+
+		} catch(...) {
+
+			// Put the unsent rules back in front of the queue for the next batch.
+			lock_guard<mutex> lock(guard);
+			rules->pending.insert(rules->pending.begin(),batch.begin()+sent,batch.end());
+			rules->reset(Rules::interval);
+			rules->enable();
+			throw;
+
+		}
+
+		// One flush for the whole batch.
+		flush();
+
+	}
+
+ }
+
@@ -0,0 +1,411 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+ /**
+  * @brief Implements the name owner registry.
+  */
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <udjat/tools/dbus/connection.h>
+ #include <udjat/tools/dbus/message.h>
+ #include <udjat/tools/dbus/exception.h>
+ #include <udjat/tools/logger.h>
+ #include <string>
+ #include <vector>
+ #include <unordered_map>
+ #include <unordered_set>
+ #include <mutex>
+ #include <memory>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	/// @brief Name owners, loaded once and kept up to date by NameOwnerChanged.
+	class DBus::Connection::Names : public std::enable_shared_from_this<DBus::Connection::Names> {
+	private:
+		DBus::Connection &connection;
+
+		std::mutex guard;
+
+		/// @brief Serialize load(), it's not held during the bus calls.
+		std::mutex loader;
+
+		/// @brief True after ListNames.
+		bool loaded = false;
+
+		/// @brief True while ListNames is running.
+		bool loading = false;
+
+		/// @brief Names released while loading, not to be restored from the list.
+		std::unordered_set<std::string> released;
+
+		/// @brief Owner for every name on the bus, empty while GetNameOwner is pending.
+		std::unordered_map<std::string,std::string> owners;
+
+		struct Watcher {
+			size_t id;
+			std::string name;	///< @brief The watched name, empty for all.
+			NameOwnerCallback callback;
+		};
+
+		std::vector<Watcher> watchers;
+		size_t last_id = 0;
+
+		/// @brief The NameOwnerChanged subscription.
+		std::shared_ptr<const Member> member;
+
+		void changed(const std::string &name, const std::string &owner) {
+
+			std::vector<NameOwnerCallback> callbacks;
+
+			{
+				lock_guard<mutex> lock(guard);
+
+				if(owner.empty()) {
+					owners.erase(name);
+					if(loading) {
+						released.insert(name);
+					}
+				} else {
+					owners[name] = owner;
+				}
+
+				for(const auto &watcher : watchers) {
+					if(watcher.name.empty() || watcher.name == name) {
+						callbacks.push_back(watcher.callback);
+					}
+				}
+			}
+
+			for(const auto &callback : callbacks) {
+				try {
+					callback(name.c_str(),owner.c_str());
+				} catch(const std::exception &e) {
+					Logger::String{"Error on name owner watcher: ",e.what()}.error(connection.name());
+				} catch(...) {
+					Logger::String{"Unexpected error on name owner watcher"}.error(connection.name());
+				}
+			}
+
+		}
+
+		/// @brief Ask the owners of the well-known names, with a single flush.
+		void resolve(const std::vector<std::string> &names) {
+
+			std::vector<DBusMessage *> requests;
+			requests.reserve(names.size());
+
+			try {
+
+				for(const auto &name : names) {
+					DBusMessage *message = dbus_message_new_method_call(DBUS_SERVICE_DBUS,DBUS_PATH_DBUS,DBUS_INTERFACE_DBUS,"GetNameOwner");
+					if(!message) {
+						throw std::runtime_error("Error creating DBus method call");
+					}
+					requests.push_back(message);
+					const char *str = name.c_str();
+					if(!dbus_message_append_args(message,DBUS_TYPE_STRING,&str,DBUS_TYPE_INVALID)) {
+						throw std::runtime_error("Error appending arguments to DBus method call");
+					}
+				}
+
+				auto names_ptr = shared_from_this();
+				connection.call_batch(requests,[names_ptr,names](size_t index, Message &response){
+
+					if(response.failed()) {
+						// Released before the reply, NameOwnerChanged will remove it.
+						return;
+					}
+
+					std::string owner;
+					response.pop(owner);
+
+					lock_guard<mutex> lock(names_ptr->guard);
+					auto it = names_ptr->owners.find(names[index]);
+					if(it != names_ptr->owners.end() && it->second.empty()) {
+						it->second = owner;
+					}
+
+				});
+
+			} catch(...) {
+				for(DBusMessage *message : requests) {
+					dbus_message_unref(message);
+				}
+				throw;
+			}
+
+			for(DBusMessage *message : requests) {
+				dbus_message_unref(message);
+			}
+
+		}
+
+	public:
+
+		Names(DBus::Connection &c) : connection{c} {
+		}
+
+		/// @brief Subscribe to NameOwnerChanged and get the current names.
+		/// @details The bus calls are made without the guard, the registry keeps answering
+		/// from memory and tracking the changes while loading.
+		void load() {
+
+			// One load at a time.
+			lock_guard<mutex> serialize(loader);
+
+			{
+				lock_guard<mutex> lock(guard);
+				if(loaded) {
+					return;
+				}
+				loading = true;
+				released.clear();
+			}
+
+			try {
+
+				if(!member) {
+
+					Member::Match match;
+					match.sender = DBUS_SERVICE_DBUS;
+					match.path = DBUS_PATH_DBUS;
+
+					std::weak_ptr<Names> names = shared_from_this();
+					member = connection.subscribe(DBUS_INTERFACE_DBUS,"NameOwnerChanged",match,[names](Message &message){
+						auto registry = names.lock();
+						if(registry) {
+							std::string name, old_owner, new_owner;
+							message.pop(name).pop(old_owner).pop(new_owner);
+							registry->changed(name,new_owner);
+						}
+						return false;
+					}).shared_from_this();
+
+					// The bus handles our messages in order, the rule is active before ListNames.
+					connection.commit();
+
+				}
+
+				std::vector<std::string> listed;
+				connection.call_and_wait(DBUS_SERVICE_DBUS,DBUS_PATH_DBUS,DBUS_INTERFACE_DBUS,"ListNames",[&listed](Message &response){
+
+					response.except();
+
+					DBusMessageIter *iter = response.getIter();
+					if(dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_ARRAY) {
+						throw runtime_error("Unexpected response from ListNames");
+					}
+
+					DBusMessageIter array;
+					dbus_message_iter_recurse(iter,&array);
+
+					while(dbus_message_iter_get_arg_type(&array) == DBUS_TYPE_STRING) {
+						DBusBasicValue value;
+						dbus_message_iter_get_basic(&array,&value);
+						listed.emplace_back(value.str);
+						dbus_message_iter_next(&array);
+					}
+
+				});
+
+				// Merge, the changes received while loading are newer than the list.
+				std::vector<std::string> pending;
+				{
+					lock_guard<mutex> lock(guard);
+
+					for(const auto &name : listed) {
+
+						if(owners.find(name) != owners.end() || released.find(name) != released.end()) {
+							continue;
+						}
+
+						if(name[0] == ':') {
+							// Unique names own themselves.
+							owners[name] = name;
+						} else if(name != DBUS_SERVICE_DBUS) {
+							owners[name];
+							pending.push_back(name);
+						} else {
+							owners[name] = DBUS_SERVICE_DBUS;
+						}
+
+					}
+
+					loaded = true;
+					loading = false;
+					released.clear();
+				}
+
+				if(!pending.empty()) {
+					resolve(pending);
+				}
+
+			} catch(...) {
+
+				lock_guard<mutex> lock(guard);
+				loading = false;
+				released.clear();
+				throw;
+
+			}
+
+		}
+
+		/// @brief Ask the bus for the owner, without the registry.
+		std::string query(const char *name) {
+
+			std::string owner;
+
+			connection.call_and_wait(
+				DBus::Message{DBUS_SERVICE_DBUS,DBUS_PATH_DBUS,DBUS_INTERFACE_DBUS,"GetNameOwner",name},
+				[&owner](Message &response){
+					if(!response.failed()) {
+						response.pop(owner);
+					}
+				}
+			);
+
+			return owner;
+
+		}
+
+		bool has_owner(const char *name) {
+			lock_guard<mutex> lock(guard);
+			return owners.find(name) != owners.end();
+		}
+
+		/// @brief Get owner from memory.
+		/// @return false if the owner is not known yet.
+		bool owner(const char *name, std::string &value) {
+			lock_guard<mutex> lock(guard);
+			auto it = owners.find(name);
+			if(it == owners.end()) {
+				value.clear();
+				return true;
+			}
+			value = it->second;
+			return !value.empty();
+		}
+
+		size_t insert(const char *name, const NameOwnerCallback &callback) {
+			lock_guard<mutex> lock(guard);
+			watchers.push_back({++last_id,(name ? name : ""),callback});
+			return last_id;
+		}
+
+		void remove(size_t id) {
+			lock_guard<mutex> lock(guard);
+			for(auto it = watchers.begin(); it != watchers.end(); it++) {
+				if(it->id == id) {
+					watchers.erase(it);
+					return;
+				}
+			}
+		}
+
+	};
+
+	std::shared_ptr<DBus::Connection::Names> DBus::Connection::NamesFactory(Connection &connection) {
+		return make_shared<Names>(connection);
+	}
+
+	std::shared_ptr<DBus::Connection::Names> DBus::Connection::registry() const {
+
+		std::shared_ptr<Names> registry;
+		{
+			lock_guard<mutex> lock(guard);
+			registry = names;
+		}
+
+		registry->load();
+		return registry;
+
+	}
+
+	bool DBus::Connection::name_has_owner(const char *name) const {
+
+		try {
+
+			return registry()->has_owner(name);
+
+		} catch(const std::exception &e) {
+
+			Logger::String{"Can't load name owners: ",e.what()}.warning(this->name());
+
+		}
+
+		DBus::Error error;
+		dbus_bool_t rc = dbus_bus_name_has_owner(conn, name, error);
+		error.verify();
+		return rc;
+
+	}
+
+	std::string DBus::Connection::name_owner(const char *name) const {
+
+		std::string owner;
+
+		try {
+
+			if(registry()->owner(name,owner)) {
+				return owner;
+			}
+
+		} catch(const std::exception &e) {
+
+			Logger::String{"Can't load name owners: ",e.what()}.warning(this->name());
+
+		}
+
+		// Not resolved yet, ask the bus.
+		std::shared_ptr<Names> registry;
+		{
+			lock_guard<mutex> lock(guard);
+			registry = names;
+		}
+
+		return registry->query(name);
+
+	}
+
+	size_t DBus::Connection::watch_name(const char *name, const NameOwnerCallback &callback) {
+		auto names = registry();
+		return names->insert(name,callback);
+	}
+
+	void DBus::Connection::unwatch_name(size_t id) {
+
+		std::shared_ptr<Names> registry;
+		{
+			lock_guard<mutex> lock(guard);
+			registry = names;
+		}
+
+		if(registry) {
+			registry->remove(id);
+		}
+
+	}
+
+ }
+
@@ -0,0 +1,586 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+ /**
+  * @brief Implements the client-side property cache.
+  */
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <udjat/tools/dbus/connection.h>
+ #include <udjat/tools/dbus/message.h>
+ #include <udjat/tools/logger.h>
+ #include <udjat/tools/memory.h>
+ #include <udjat/tools/dbus/deadline.h>
+ #include <private/deferred.h>
+ #include <unistd.h>
+ #include <string>
+ #include <vector>
+ #include <unordered_map>
+ #include <mutex>
+ #include <memory>
+ #include <functional>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	/// @brief Copy a single value, recursing into containers.
+	static void copy_value(DBusMessageIter *from, DBusMessageIter *to) {
+
+		int type = dbus_message_iter_get_arg_type(from);
+
+		if(dbus_type_is_basic(type)) {
+
+			DBusBasicValue value;
+			dbus_message_iter_get_basic(from,&value);
+			bool rc = dbus_message_iter_append_basic(to,type,&value);
+			if(type == DBUS_TYPE_UNIX_FD) {
+				// Both calls dup() the descriptor.
+				::close(value.fd);
+			}
+			if(!rc) {
+				throw runtime_error("Can't add value to d-bus iterator");
+			}
+			return;
+
+		}
+
+		DBusMessageIter fsub, tsub;
+		dbus_message_iter_recurse(from,&fsub);
+
+		// Variants and arrays need the contained type.
+		char *signature = nullptr;
+		if(type == DBUS_TYPE_VARIANT || type == DBUS_TYPE_ARRAY) {
+			signature = dbus_message_iter_get_signature(&fsub);
+		}
+
+		if(!dbus_message_iter_open_container(to,type,signature,&tsub)) {
+			dbus_free(signature);
+			throw runtime_error("Can't open d-bus container");
+		}
+		dbus_free(signature);
+
+		while(dbus_message_iter_get_arg_type(&fsub) != DBUS_TYPE_INVALID) {
+			copy_value(&fsub,&tsub);
+			dbus_message_iter_next(&fsub);
+		}
+
+		if(!dbus_message_iter_close_container(to,&tsub)) {
+			throw runtime_error("Can't close d-bus container");
+		}
+
+	}
+
+	/// @brief Build a reply with the variant, as returned by Properties.Get.
+	static std::shared_ptr<DBusMessage> PropertyFactory(DBusMessageIter *variant) {
+
+		auto message = make_handle(dbus_message_new(DBUS_MESSAGE_TYPE_METHOD_RETURN),dbus_message_unref);
+		if(!message) {
+			throw runtime_error("Can't create d-bus message");
+		}
+
+		DBusMessageIter iter;
+		dbus_message_iter_init_append(message.get(),&iter);
+		copy_value(variant,&iter);
+
+		return message;
+
+	}
+
+	/// @brief Parse a{sv} into property replies.
+	static void parse_properties(DBusMessageIter *iter, std::unordered_map<std::string,std::shared_ptr<DBusMessage>> &values) {
+
+		if(dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_ARRAY) {
+			throw runtime_error("Invalid d-bus property list");
+		}
+
+		DBusMessageIter array;
+		dbus_message_iter_recurse(iter,&array);
+
+		while(dbus_message_iter_get_arg_type(&array) == DBUS_TYPE_DICT_ENTRY) {
+
+			DBusMessageIter entry;
+			dbus_message_iter_recurse(&array,&entry);
+
+			if(dbus_message_iter_get_arg_type(&entry) == DBUS_TYPE_STRING) {
+				DBusBasicValue name;
+				dbus_message_iter_get_basic(&entry,&name);
+				dbus_message_iter_next(&entry);
+				if(dbus_message_iter_get_arg_type(&entry) == DBUS_TYPE_VARIANT) {
+					values[name.str] = PropertyFactory(&entry);
+				}
+			}
+
+			dbus_message_iter_next(&array);
+		}
+
+	}
+
+	/// @brief Cached properties by (destination, path, interface).
+	class DBus::Connection::Properties : public std::enable_shared_from_this<DBus::Connection::Properties> {
+	public:
+
+		struct Key {
+			std::string destination;
+			std::string path;
+			std::string interface;
+
+			inline bool operator==(const Key &key) const noexcept {
+				return destination == key.destination && path == key.path && interface == key.interface;
+			}
+		};
+
+		struct KeyHash {
+			size_t operator()(const Key &key) const noexcept {
+				std::hash<std::string> hash;
+				return hash(key.destination) ^ (hash(key.path) * 31) ^ (hash(key.interface) * 1099511628211ULL);
+			}
+		};
+
+		typedef std::function<void(Message & message)> Callback;
+
+		struct Entry {
+
+			enum : uint8_t {
+				Empty,		///< @brief Not loaded.
+				Loading,	///< @brief Waiting for GetAll.
+				Ready,		///< @brief Loaded, updated by PropertiesChanged.
+				Unsupported	///< @brief GetAll failed, read with Get until the owner changes.
+			} state = Empty;
+
+			/// @brief Incremented when the owner changes, stale replies are not cached.
+			size_t generation = 0;
+
+			/// @brief Unique name of the owner answering GetAll.
+			std::string owner;
+
+			/// @brief Properties, as the reply for Properties.Get.
+			std::unordered_map<std::string,std::shared_ptr<DBusMessage>> values;
+
+			/// @brief Reads waiting for GetAll.
+			std::vector<std::pair<std::string,Callback>> waiting;
+
+			bool subscribed = false;
+
+		};
+
+	private:
+		DBus::Connection &connection;
+
+		std::mutex guard;
+		std::unordered_map<Key,Entry,KeyHash> entries;
+
+		/// @brief Destinations with a NameOwnerChanged subscription.
+		std::unordered_map<std::string,bool> owners;
+
+		/// @brief Signal subscriptions, removed with the cache; kept alive if removed before it.
+		std::vector<std::shared_ptr<const Member>> members;
+
+		static void deliver(const Callback &call, Message &message) noexcept {
+			try {
+				call(message);
+			} catch(const std::exception &e) {
+				Logger::String{"Error processing d-bus property: ",e.what()}.error("d-bus");
+			} catch(...) {
+				Logger::String{"Unexpected error processing d-bus property"}.error("d-bus");
+			}
+		}
+
+		/// @brief Subscribe to changes on the key, before loading it.
+		void subscribe(const Key &key, bool owner) {
+
+			std::weak_ptr<Properties> cache = shared_from_this();
+			std::vector<std::shared_ptr<const Member>> added;
+
+			{
+				Member::Match match;
+				match.sender = key.destination;
+				match.path = key.path;
+				match.args.emplace_back(0,key.interface);
+
+				added.push_back(connection.subscribe(DBUS_INTERFACE_PROPERTIES,"PropertiesChanged",match,[cache,key](Message &message){
+					auto properties = cache.lock();
+					if(properties) {
+						properties->changed(key,(DBusMessage *) message);
+					}
+					return false;
+				}).shared_from_this());
+			}
+
+			if(owner) {
+				Member::Match match;
+				match.sender = DBUS_SERVICE_DBUS;
+				match.path = DBUS_PATH_DBUS;
+				match.args.emplace_back(0,key.destination);
+
+				std::string destination{key.destination};
+				added.push_back(connection.subscribe(DBUS_INTERFACE_DBUS,"NameOwnerChanged",match,[cache,destination](Message &){
+					auto properties = cache.lock();
+					if(properties) {
+						properties->reset(destination.c_str());
+					}
+					return false;
+				}).shared_from_this());
+			}
+
+			{
+				lock_guard<mutex> lock(guard);
+				members.insert(members.end(),added.begin(),added.end());
+			}
+
+			// The bus handles our messages in order, the rules are active before GetAll.
+			connection.commit();
+
+		}
+
+		/// @brief Apply PropertiesChanged.
+		void changed(const Key &key, DBusMessage *message) {
+
+			DBusMessageIter iter;
+			if(!dbus_message_iter_init(message,&iter)) {
+				return;
+			}
+
+			// Interface, already checked by the match rule.
+			dbus_message_iter_next(&iter);
+
+			std::unordered_map<std::string,std::shared_ptr<DBusMessage>> values;
+			parse_properties(&iter,values);
+			dbus_message_iter_next(&iter);
+
+			std::vector<std::string> invalidated;
+			if(dbus_message_iter_get_arg_type(&iter) == DBUS_TYPE_ARRAY) {
+				DBusMessageIter array;
+				dbus_message_iter_recurse(&iter,&array);
+				while(dbus_message_iter_get_arg_type(&array) == DBUS_TYPE_STRING) {
+					DBusBasicValue name;
+					dbus_message_iter_get_basic(&array,&name);
+					invalidated.emplace_back(name.str);
+					dbus_message_iter_next(&array);
+				}
+			}
+
+			lock_guard<mutex> lock(guard);
+
+			auto it = entries.find(key);
+			if(it == entries.end() || it->second.state != Entry::Ready) {
+				// Not loaded, GetAll will get the new values.
+				return;
+			}
+
+			Entry &entry = it->second;
+
+			const char *sender = dbus_message_get_sender(message);
+			if(!(sender && entry.owner == sender)) {
+				return;
+			}
+
+			for(auto &value : values) {
+				entry.values[value.first] = value.second;
+			}
+
+			for(const auto &name : invalidated) {
+				entry.values.erase(name);
+			}
+
+		}
+
+		/// @brief The destination has a new owner, forget its properties.
+		void reset(const char *destination) {
+
+			lock_guard<mutex> lock(guard);
+
+			for(auto &it : entries) {
+				if(it.first.destination == destination) {
+					Entry &entry = it.second;
+					entry.generation++;
+					entry.owner.clear();
+					entry.values.clear();
+					if(entry.state == Entry::Ready || entry.state == Entry::Unsupported) {
+						entry.state = Entry::Empty;
+					}
+				}
+			}
+
+		}
+
+		/// @brief Got GetAll reply.
+		void loaded(const Key &key, size_t generation, Message &response) {
+
+			std::unordered_map<std::string,std::shared_ptr<DBusMessage>> values;
+			std::vector<std::pair<std::string,Callback>> waiting;
+
+			bool failed = response.failed();
+			if(!failed) {
+				try {
+					parse_properties(response.getIter(),values);
+				} catch(const std::exception &e) {
+					Logger::String{"Error parsing d-bus properties: ",e.what()}.error(connection.name());
+					failed = true;
+				}
+			}
+
+			{
+				lock_guard<mutex> lock(guard);
+
+				Entry &entry = entries[key];
+				waiting.swap(entry.waiting);
+
+				if(entry.generation != generation) {
+					// Don't cache, the owner changed.
+					entry.state = Entry::Empty;
+				} else if(failed) {
+					// No GetAll (or not allowed), don't try it again for this owner.
+					entry.state = Entry::Unsupported;
+				} else {
+					const char *sender = dbus_message_get_sender((DBusMessage *) response);
+					entry.owner = (sender ? sender : "");
+					entry.values = values;
+					entry.state = Entry::Ready;
+				}
+			}
+
+			for(auto &waiter : waiting) {
+
+				auto value = values.find(waiter.first);
+				if(failed || value == values.end()) {
+					// Not on GetAll, ask for it.
+					try {
+						fetch(key,waiter.first.c_str(),waiter.second,DBUS_TIMEOUT_USE_DEFAULT);
+					} catch(const std::exception &e) {
+						Logger::String{"Error getting d-bus property: ",e.what()}.error(connection.name());
+					}
+					continue;
+				}
+
+				Message message{value->second.get()};
+				deliver(waiter.second,message);
+
+			}
+
+		}
+
+		/// @brief Get a single property with Properties.Get, cache it if the entry is loaded.
+		void fetch(const Key &key, const char *name, const Callback &call, int timeout) {
+
+			size_t generation;
+			{
+				lock_guard<mutex> lock(guard);
+				generation = entries[key].generation;
+			}
+
+			auto message = make_handle(
+				dbus_message_new_method_call(key.destination.c_str(),key.path.c_str(),DBUS_INTERFACE_PROPERTIES,"Get"),
+				dbus_message_unref
+			);
+
+			if(!message) {
+				throw std::runtime_error("Error creating DBus method call");
+			}
+
+			const char *interface = key.interface.c_str();
+			if(!dbus_message_append_args(message.get(),DBUS_TYPE_STRING,&interface,DBUS_TYPE_STRING,&name,DBUS_TYPE_INVALID)) {
+				throw std::runtime_error("Error appending arguments to DBus method call");
+			}
+
+			auto cache = shared_from_this();
+			std::string property{name};
+			connection.call(message.get(),[cache,key,property,generation,call](Message &response){
+
+				DBusMessage *reply = (DBusMessage *) response;
+				if(reply && !response.failed()) {
+					lock_guard<mutex> lock(cache->guard);
+					Entry &entry = cache->entries[key];
+					if(entry.state == Entry::Ready && entry.generation == generation) {
+						entry.values[property] = std::shared_ptr<DBusMessage>(dbus_message_ref(reply),dbus_message_unref);
+					}
+				}
+
+				call(response);
+
+			},timeout);
+
+		}
+
+	public:
+
+		Properties(DBus::Connection &c) : connection{c} {
+		}
+
+		/// @brief Remove the signal subscriptions.
+		void clear() {
+
+			std::vector<std::shared_ptr<const Member>> subscriptions;
+			{
+				lock_guard<mutex> lock(guard);
+				subscriptions.swap(members);
+			}
+
+			// Already removed ones are not found, the reference keeps them valid.
+			for(const auto &member : subscriptions) {
+				connection.remove(*member);
+			}
+
+		}
+
+		void get(const char *destination, const char *path, const char *interface, const char *name, const Callback &call, int timeout) {
+
+			Key key{destination,path,interface};
+			std::shared_ptr<DBusMessage> value;
+			size_t generation = 0;
+			bool subscribe = false, owner = false, load = false;
+
+			{
+				lock_guard<mutex> lock(guard);
+
+				Entry &entry = entries[key];
+
+				if(!entry.subscribed) {
+					entry.subscribed = subscribe = true;
+					bool &subscribed = owners[key.destination];
+					owner = !subscribed;
+					subscribed = true;
+				}
+
+				switch(entry.state) {
+				case Entry::Ready:
+					{
+						auto it = entry.values.find(name);
+						if(it != entry.values.end()) {
+							value = it->second;
+						}
+					}
+					break;
+
+				case Entry::Loading:
+					entry.waiting.emplace_back(name,call);
+					return;
+
+				case Entry::Unsupported:
+					break;
+
+				case Entry::Empty:
+					entry.state = Entry::Loading;
+					entry.waiting.emplace_back(name,call);
+					generation = entry.generation;
+					load = true;
+					break;
+
+				}
+
+			}
+
+			if(value) {
+				// Cached, no bus traffic; from the main loop, like a reply.
+				Deadline::TimePoint deadline = Deadline::limit();
+				Deferred::getInstance().push_back([call,value,deadline](){
+					Deadline scope{deadline};
+					Message message{value.get()};
+					deliver(call,message);
+				});
+				return;
+			}
+
+			if(subscribe) {
+				this->subscribe(key,owner);
+			}
+
+			if(!load) {
+				// Invalidated, not on GetAll or without GetAll.
+				fetch(key,name,call,timeout);
+				return;
+			}
+
+			try {
+
+				auto message = make_handle(
+					dbus_message_new_method_call(destination,path,DBUS_INTERFACE_PROPERTIES,"GetAll"),
+					dbus_message_unref
+				);
+
+				if(!message) {
+					throw std::runtime_error("Error creating DBus method call");
+				}
+
+				if(!dbus_message_append_args(message.get(),DBUS_TYPE_STRING,&interface,DBUS_TYPE_INVALID)) {
+					throw std::runtime_error("Error appending arguments to DBus method call");
+				}
+
+				auto cache = shared_from_this();
+				connection.call(message.get(),[cache,key,generation](Message &response){
+					cache->loaded(key,generation,response);
+				},timeout);
+
+			} catch(...) {
+
+				// Not sent, the next read tries again.
+				lock_guard<mutex> lock(guard);
+				Entry &entry = entries[key];
+				entry.state = Entry::Empty;
+				entry.waiting.clear();
+				throw;
+
+			}
+
+		}
+
+	};
+
+	void DBus::Connection::property_cache(bool enable) {
+
+		std::shared_ptr<Properties> cache;
+
+		{
+			lock_guard<mutex> lock(guard);
+			if(enable == (bool) properties) {
+				return;
+			}
+			if(enable) {
+				properties = make_shared<Properties>(*this);
+				return;
+			}
+			cache.swap(properties);
+		}
+
+		// Pending reads keep the cache alive until the replies arrive.
+		cache->clear();
+
+	}
+
+	bool DBus::Connection::get_cached(const char *destination, const char *path, const char *interface, const char *property_name, const std::function<void(Udjat::DBus::Message & message)> &call, int timeout) {
+
+		std::shared_ptr<Properties> cache;
+		{
+			lock_guard<mutex> lock(guard);
+			cache = properties;
+		}
+
+		if(!cache) {
+			return false;
+		}
+
+		cache->get(destination,path,interface,property_name,call,timeout);
+		return true;
+
+	}
+
+ }
+
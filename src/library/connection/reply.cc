@@ -0,0 +1,225 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+ /**
+  * @brief Implements asynchronous call replies.
+  */
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <udjat/tools/dbus/connection.h>
+ #include <udjat/tools/dbus/message.h>
+ #include <private/pending.h>
+ #include <udjat/tools/dbus/reply.h>
+ #include <udjat/tools/logger.h>
+ #include <mutex>
+ #include <future>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	struct DBus::Reply::State {
+
+		std::mutex guard;
+		std::promise<std::shared_ptr<Message>> promise;
+		std::shared_future<std::shared_ptr<Message>> future;
+		std::shared_ptr<Message> response;
+		std::function<void(const std::shared_ptr<Message> &response)> continuation;
+
+		State() : future{promise.get_future().share()} {
+		}
+
+	};
+
+	DBus::Reply::Reply() : state{make_shared<State>()} {
+	}
+
+	DBus::Reply::~Reply() {
+	}
+
+	static std::shared_ptr<DBus::Message> error_message(const char *name, const char *message) {
+		DBusError error;
+		dbus_error_init(&error);
+		dbus_set_error(&error, name, "%s", message);
+		auto response = make_shared<DBus::Message>(error);
+		dbus_error_free(&error);
+		return response;
+	}
+
+	void DBus::Reply::complete(Message &response) const {
+
+		// The response is owned by the caller, keep a reference to the d-bus message.
+		std::shared_ptr<Message> message;
+		if(response.failed()) {
+			message = error_message(response.error_name(),response.error_message());
+		} else if((DBusMessage *) response) {
+			message = make_shared<Message>((DBusMessage *) response);
+		} else {
+			message = error_message(DBUS_ERROR_NO_REPLY,"No response");
+		}
+
+		std::function<void(const std::shared_ptr<Message> &response)> continuation;
+		{
+			lock_guard<mutex> lock(state->guard);
+			if(state->response) {
+				return;
+			}
+			state->response = message;
+			continuation.swap(state->continuation);
+		}
+
+		state->promise.set_value(message);
+
+		if(continuation) {
+			continuation(message);
+		}
+
+	}
+
+	bool DBus::Reply::ready() const {
+		lock_guard<mutex> lock(state->guard);
+		return (bool) state->response;
+	}
+
+	std::shared_ptr<DBus::Message> DBus::Reply::get() const {
+		return state->future.get();
+	}
+
+	std::shared_future<std::shared_ptr<DBus::Message>> DBus::Reply::future() const {
+		return state->future;
+	}
+
+	void DBus::Reply::then(const std::function<void(const std::shared_ptr<Message> &response)> &call) const {
+
+		std::shared_ptr<Message> response;
+
+		{
+			lock_guard<mutex> lock(state->guard);
+
+			if(!state->response) {
+
+				if(state->continuation) {
+					// Chain with the previous one.
+					auto previous = std::move(state->continuation);
+					state->continuation = [previous,call](const std::shared_ptr<Message> &response) {
+						previous(response);
+						call(response);
+					};
+				} else {
+					state->continuation = call;
+				}
+
+				return;
+			}
+
+			response = state->response;
+		}
+
+		call(response);
+
+	}
+
+	void DBus::Reply::failed(std::exception_ptr exception) noexcept {
+
+		try {
+
+			std::rethrow_exception(exception);
+
+		} catch(const std::exception &e) {
+
+			Logger::String{"Unexpected error on d-bus coroutine: ",e.what()}.error("d-bus");
+
+		} catch(...) {
+
+			Logger::String{"Unexpected error on d-bus coroutine"}.error("d-bus");
+
+		}
+
+	}
+
+	/// @brief Completes the reply with an error if the pending call is released without response.
+	struct DBus::Reply::Completion {
+
+		Reply reply;
+
+		~Completion() {
+
+			if(reply.ready()) {
+				return;
+			}
+
+			try {
+				DBusError error;
+				dbus_error_init(&error);
+				dbus_set_error_const(&error, PendingCall::cancelled, "The call was cancelled");
+				Message message{error};
+				reply.complete(message);
+			} catch(const std::exception &e) {
+				Logger::String{"Error cancelling d-bus reply: ",e.what()}.error("d-bus");
+			}
+
+		}
+
+	};
+
+	DBus::Reply DBus::Connection::call_async(DBusMessage * message, int timeout) {
+
+		auto completion = make_shared<Reply::Completion>();
+
+		PendingCall *record = PendingCall::acquire();
+		record->emplace([completion](Message &response){
+			completion->reply.complete(response);
+		});
+
+		send(message,record,timeout);
+
+		return completion->reply;
+
+	}
+
+	DBus::Reply DBus::Connection::call_async(const Message & request, int timeout) {
+		return call_async((DBusMessage *) request,timeout);
+	}
+
+	DBus::Reply DBus::Connection::call_async(const char *destination, const char *path, const char *interface, const char *member, int timeout) {
+
+		if(!conn) {
+			throw logic_error("Connection is not available");
+		}
+
+		DBusMessage * message = dbus_message_new_method_call(destination,path,interface,member);
+		if(message == NULL) {
+			throw std::runtime_error("Error creating DBus method call");
+		}
+
+		try {
+			Reply reply = call_async(message,timeout);
+			dbus_message_unref(message);
+			return reply;
+		} catch(...) {
+			dbus_message_unref(message);
+			throw;
+		}
+
+	}
+
+ }
+
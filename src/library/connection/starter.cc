@@ -35,6 +35,7 @@
 
 	static DBusConnection *connct = NULL;
 	static size_t refcount = 0;
+	static mutex bus_guard;
 
 	static void trace_connection_free(DBusConnection **connection) {
 		if(refcount) {
@@ -47,7 +48,7 @@
 
 	DBusConnection * DBus::StarterBus::ConnectionFactory() {
 
-		lock_guard<mutex> lock(guard);
+		lock_guard<mutex> lock(bus_guard);
 
 		if(connct) {
 			refcount++;
@@ -88,7 +89,7 @@
 		}
 
 		{
-			lock_guard<mutex> lock(guard);
+			lock_guard<mutex> lock(bus_guard);
 			refcount--;
 
 			debug("StarterBus refcount is ",refcount);
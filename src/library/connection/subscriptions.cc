@@ -0,0 +1,204 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+ /**
+  * @brief Implements the connection dispatch table.
+  */
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <udjat/tools/dbus/interface.h>
+ #include <udjat/tools/dbus/member.h>
+ #include <udjat/tools/string.h>
+ #include <private/subscriptions.h>
+ #include <algorithm>
+ #include <cctype>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	static inline size_t hash_name(size_t hash, const char *name) noexcept {
+		// FNV-1a over the lowercase name.
+		if(name) {
+			for(const unsigned char *ptr = (const unsigned char *) name; *ptr; ptr++) {
+				hash ^= (size_t) tolower(*ptr);
+				hash *= 1099511628211ULL;
+			}
+		}
+		return hash;
+	}
+
+	static inline bool same_name(const char *a, const char *b) noexcept {
+		if(a == b) {
+			return true;
+		}
+		if(!(a && b)) {
+			return false;
+		}
+		return strcasecmp(a,b) == 0;
+	}
+
+	size_t DBus::Subscriptions::Hash::operator()(const char *name) const noexcept {
+		return hash_name(14695981039346656037ULL,name);
+	}
+
+	bool DBus::Subscriptions::Equal::operator()(const char *a, const char *b) const noexcept {
+		return same_name(a,b);
+	}
+
+	size_t DBus::Subscriptions::KeyHash::operator()(const Key &key) const noexcept {
+		return hash_name(14695981039346656037ULL ^ (size_t) key.type,key.member);
+	}
+
+	bool DBus::Subscriptions::KeyEqual::operator()(const Key &a, const Key &b) const noexcept {
+		return a.type == b.type && same_name(a.member,b.member);
+	}
+
+	std::shared_ptr<const DBus::Subscriptions> DBus::Subscriptions::insert(const Interface &interface, const std::shared_ptr<const Member> &member) const {
+
+		// The key outlives the member, use interned strings.
+		const char *name = String{interface.c_str()}.as_quark();
+		Key key{member->message_type(),String{member->c_str()}.as_quark()};
+
+		auto it = interfaces.find(name);
+		if(it != interfaces.end()) {
+
+			// Known interface, copy only its table.
+			auto table = make_shared<Table>(*std::atomic_load(&it->second->table));
+			(*table)[key].push_back(member);
+			return update(name,it->second,table);
+
+		}
+
+		auto table = make_shared<Table>();
+		(*table)[key].push_back(member);
+
+		auto slot = make_shared<Slot>();
+		slot->table = table;
+
+		auto snapshot = make_shared<Subscriptions>();
+		snapshot->interfaces = interfaces;
+		snapshot->interfaces[name] = slot;
+
+		return snapshot;
+
+	}
+
+	std::shared_ptr<const DBus::Subscriptions> DBus::Subscriptions::update(const char *name, const std::shared_ptr<Slot> &slot, const std::shared_ptr<const Table> &table) const {
+
+		if(table->empty()) {
+			return erase(name);
+		}
+
+		std::atomic_store(&slot->table,table);
+		return shared_from_this();
+
+	}
+
+	std::shared_ptr<const DBus::Subscriptions> DBus::Subscriptions::erase(const char *name) const {
+		auto snapshot = make_shared<Subscriptions>();
+		snapshot->interfaces = interfaces;
+		snapshot->interfaces.erase(name);
+		return snapshot;
+	}
+
+	std::shared_ptr<const DBus::Subscriptions> DBus::Subscriptions::remove(const Interface &interface, const Member &member) const {
+
+		auto it = interfaces.find(interface.c_str());
+		if(it == interfaces.end()) {
+			return shared_from_this();
+		}
+
+		auto table = make_shared<Table>(*std::atomic_load(&it->second->table));
+
+		auto entry = table->find(Key{member.message_type(),member.c_str()});
+		if(entry != table->end()) {
+
+			Members &members = entry->second;
+			members.erase(
+				std::remove_if(members.begin(),members.end(),[&member](const std::shared_ptr<const Member> &m){
+					return m.get() == &member;
+				}),
+				members.end()
+			);
+
+			if(members.empty()) {
+				table->erase(entry);
+			}
+
+		}
+
+		return update(it->first,it->second,table);
+
+	}
+
+	std::shared_ptr<const DBus::Subscriptions> DBus::Subscriptions::remove(const Interface &interface) const {
+
+		auto it = interfaces.find(interface.c_str());
+		if(it == interfaces.end()) {
+			return shared_from_this();
+		}
+
+		auto table = make_shared<Table>(*std::atomic_load(&it->second->table));
+		for(const auto &member : interface.members) {
+
+			auto entry = table->find(Key{member->message_type(),member->c_str()});
+			if(entry == table->end()) {
+				continue;
+			}
+
+			Members &members = entry->second;
+			members.erase(
+				std::remove(members.begin(),members.end(),member),
+				members.end()
+			);
+
+			if(members.empty()) {
+				table->erase(entry);
+			}
+
+		}
+
+		return update(it->first,it->second,table);
+
+	}
+
+	std::shared_ptr<const DBus::Subscriptions::Members> DBus::Subscriptions::find(DBusMessage *message) const noexcept {
+
+		auto intf = interfaces.find(dbus_message_get_interface(message));
+		if(intf == interfaces.end()) {
+			return std::shared_ptr<const Members>{};
+		}
+
+		auto table = std::atomic_load(&intf->second->table);
+
+		auto it = table->find(Key{dbus_message_get_type(message),dbus_message_get_member(message)});
+		if(it == table->end()) {
+			return std::shared_ptr<const Members>{};
+		}
+
+		// Aliased, the members are released with the table.
+		return std::shared_ptr<const Members>(table,&it->second);
+
+	}
+
+ }
+
@@ -0,0 +1,527 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+ /**
+  * @brief Implements the optional connection service thread.
+  */
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <udjat/tools/dbus/connection.h>
+ #include <udjat/tools/dbus/member.h>
+ #include <udjat/tools/logger.h>
+ #include <udjat/tools/mainloop.h>
+ #include <udjat/tools/timer.h>
+ #include <private/mainloop.h>
+ #include <private/arguments.h>
+ #include <sys/eventfd.h>
+ #include <poll.h>
+ #include <unistd.h>
+ #include <mutex>
+ #include <deque>
+ #include <map>
+ #include <vector>
+ #include <chrono>
+ #include <thread>
+ #include <functional>
+ #include <algorithm>
+ #include <system_error>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	/// @brief Work from the service thread, waiting for the main loop.
+	class DBus::Connection::Marshal : public MainLoop::Timer, public std::enable_shared_from_this<Marshal> {
+	private:
+		std::mutex guard;
+		std::deque<std::function<void()>> pending;
+
+	protected:
+		void on_timer() override {
+
+			// The work can stop the service thread, releasing the marshal.
+			auto self = shared_from_this();
+
+			disable();
+
+			decltype(pending) tasks;
+			{
+				lock_guard<mutex> lock(guard);
+				tasks.swap(pending);
+			}
+
+			for(auto &task : tasks) {
+				try {
+					task();
+				} catch(const std::exception &e) {
+					Logger::String{"Error dispatching message: ",e.what()}.error("d-bus");
+				}
+			}
+
+		}
+
+	public:
+
+		/// @brief True if the member callbacks run on the main loop.
+		const bool members;
+
+		Marshal(bool m) : members{m} {
+		}
+
+		virtual ~Marshal() {
+			disable();
+		}
+
+		void push_back(std::function<void()> task) {
+
+			{
+				lock_guard<mutex> lock(guard);
+				pending.push_back(std::move(task));
+				if(pending.size() > 1) {
+					// Already scheduled.
+					return;
+				}
+			}
+
+			reset(0);
+			enable();
+			MainLoop::getInstance().wakeup();
+
+		}
+
+	};
+
+	/// @brief The service thread event loop: the connection watches, its timeouts and a wake up descriptor.
+	/// @details Owned by the thread, a busy main loop doesn't delay the reads or the timeouts.
+	class DBus::Connection::Loop {
+	private:
+		std::mutex guard;
+
+		/// @brief Written by wakeup(), interrupts poll().
+		int event = -1;
+
+		std::vector<DBusWatch *> watches;
+
+		struct Timeout {
+			DBusTimeout * timeout = nullptr;
+			std::multimap<std::chrono::steady_clock::time_point,Timeout *>::iterator position;
+			bool scheduled = false;		///< @brief True if it's on the queue.
+			bool firing = false;		///< @brief True while the timeout handler is running.
+		};
+
+		/// @brief Enabled timeouts, by expiration.
+		std::multimap<std::chrono::steady_clock::time_point,Timeout *> timeouts;
+
+		/// @brief Queue the timeout if enabled, requires the guard.
+		void schedule(Timeout *node) {
+			if(dbus_timeout_get_enabled(node->timeout)) {
+				auto expires = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(dbus_timeout_get_interval(node->timeout),0));
+				node->position = timeouts.emplace(expires,node);
+				node->scheduled = true;
+			}
+		}
+
+		/// @brief Remove the timeout from the queue, requires the guard.
+		void unschedule(Timeout *node) noexcept {
+			if(node->scheduled) {
+				timeouts.erase(node->position);
+				node->scheduled = false;
+			}
+		}
+
+		static dbus_bool_t add_watch(DBusWatch *watch, Loop *loop) {
+			{
+				lock_guard<mutex> lock(loop->guard);
+				loop->watches.push_back(watch);
+			}
+			loop->wakeup();
+			return TRUE;
+		}
+
+		static void remove_watch(DBusWatch *watch, Loop *loop) {
+			{
+				lock_guard<mutex> lock(loop->guard);
+				loop->watches.erase(std::remove(loop->watches.begin(),loop->watches.end(),watch),loop->watches.end());
+			}
+			loop->wakeup();
+		}
+
+		static void toggle_watch(DBusWatch *, Loop *loop) {
+			loop->wakeup();
+		}
+
+		static dbus_bool_t add_timeout(DBusTimeout *timeout, Loop *loop) {
+			Timeout *node = new Timeout();
+			node->timeout = timeout;
+			dbus_timeout_set_data(timeout,node,NULL);
+			{
+				lock_guard<mutex> lock(loop->guard);
+				loop->schedule(node);
+			}
+			loop->wakeup();
+			return TRUE;
+		}
+
+		static void remove_timeout(DBusTimeout *timeout, Loop *loop) {
+
+			Timeout *node = (Timeout *) dbus_timeout_get_data(timeout);
+			if(!node) {
+				return;
+			}
+			dbus_timeout_set_data(timeout,NULL,NULL);
+
+			lock_guard<mutex> lock(loop->guard);
+			loop->unschedule(node);
+			if(node->firing) {
+				// Released by wait() after the handler returns.
+				node->timeout = nullptr;
+			} else {
+				delete node;
+			}
+
+		}
+
+		static void toggle_timeout(DBusTimeout *timeout, Loop *loop) {
+
+			Timeout *node = (Timeout *) dbus_timeout_get_data(timeout);
+			if(!node) {
+				return;
+			}
+
+			{
+				lock_guard<mutex> lock(loop->guard);
+				loop->unschedule(node);
+				if(!node->firing) {
+					// Rescheduled by wait() after the handler returns.
+					loop->schedule(node);
+				}
+			}
+			loop->wakeup();
+
+		}
+
+		static void handle_dispatch_status(DBusConnection *, DBusDispatchStatus status, Loop *loop) {
+			// Messages queued by another thread (by a blocking call, for example).
+			if(status == DBUS_DISPATCH_DATA_REMAINS) {
+				loop->wakeup();
+			}
+		}
+
+	public:
+		Loop() : event{eventfd(0,EFD_CLOEXEC|EFD_NONBLOCK)} {
+			if(event < 0) {
+				throw system_error(errno,system_category(),"Can't create the service thread wake up descriptor");
+			}
+		}
+
+		Loop(const Loop &) = delete;
+		Loop & operator=(const Loop &) = delete;
+
+		~Loop() {
+			::close(event);
+		}
+
+		/// @brief Interrupt wait(), from any thread.
+		void wakeup() noexcept {
+			uint64_t value = 1;
+			if(::write(event,&value,sizeof(value)) < 0) {
+				// Already signaled, the counter is full.
+			}
+		}
+
+		/// @brief Move the connection watches and timeouts to this loop.
+		void attach(DBusConnection *conn) {
+
+			if(!dbus_connection_set_watch_functions(
+				conn,
+				(DBusAddWatchFunction) add_watch,
+				(DBusRemoveWatchFunction) remove_watch,
+				(DBusWatchToggledFunction) toggle_watch,
+				this,
+				nullptr)
+			) {
+				throw runtime_error("dbus_connection_set_watch_functions has failed");
+			}
+
+			if(!dbus_connection_set_timeout_functions(
+				conn,
+				(DBusAddTimeoutFunction) add_timeout,
+				(DBusRemoveTimeoutFunction) remove_timeout,
+				(DBusTimeoutToggledFunction) toggle_timeout,
+				this,
+				nullptr)
+			) {
+				throw runtime_error("dbus_connection_set_timeout_functions has failed");
+			}
+
+			dbus_connection_set_wakeup_main_function(conn,(DBusWakeupMainFunction) [](void *loop){
+				((Loop *) loop)->wakeup();
+			},this,NULL);
+
+			dbus_connection_set_dispatch_status_function(conn,(DBusDispatchStatusFunction) handle_dispatch_status,this,NULL);
+
+		}
+
+		/// @brief Release the connection watches and timeouts, after the thread is joined.
+		void detach(DBusConnection *conn) noexcept {
+			dbus_connection_set_wakeup_main_function(conn,NULL,NULL,NULL);
+			dbus_connection_set_dispatch_status_function(conn,NULL,NULL,NULL);
+			dbus_connection_set_watch_functions(conn,NULL,NULL,NULL,NULL,nullptr);
+			dbus_connection_set_timeout_functions(conn,NULL,NULL,NULL,NULL,nullptr);
+		}
+
+		/// @brief Wait for the socket, the next timeout or a wake up; handle what's ready.
+		void wait() {
+
+			std::vector<struct pollfd> fds;
+			std::vector<DBusWatch *> polled;
+			int timeout = -1;
+
+			{
+				lock_guard<mutex> lock(guard);
+
+				fds.reserve(watches.size()+1);
+				fds.push_back({event,POLLIN,0});
+
+				for(DBusWatch *watch : watches) {
+					if(!dbus_watch_get_enabled(watch)) {
+						continue;
+					}
+					unsigned int flags = dbus_watch_get_flags(watch);
+					short events = 0;
+					if(flags & DBUS_WATCH_READABLE) {
+						events |= POLLIN;
+					}
+					if(flags & DBUS_WATCH_WRITABLE) {
+						events |= POLLOUT;
+					}
+					fds.push_back({dbus_watch_get_unix_fd(watch),events,0});
+					polled.push_back(watch);
+				}
+
+				if(!timeouts.empty()) {
+					auto interval = std::chrono::duration_cast<std::chrono::milliseconds>(timeouts.begin()->first - std::chrono::steady_clock::now()).count();
+					timeout = (interval > 0 ? (int) interval + 1 : 0);
+				}
+			}
+
+			if(poll(fds.data(),fds.size(),timeout) < 0 && errno != EINTR) {
+				throw system_error(errno,system_category(),"Error waiting for d-bus events");
+			}
+
+			if(fds[0].revents & POLLIN) {
+				uint64_t value;
+				if(::read(event,&value,sizeof(value)) < 0) {
+					// Nothing to read, another wake up got it.
+				}
+			}
+
+			for(size_t ix = 0; ix < polled.size(); ix++) {
+
+				short revents = fds[ix+1].revents;
+				if(!revents) {
+					continue;
+				}
+
+				{
+					// Removed by a handler since the poll.
+					lock_guard<mutex> lock(guard);
+					if(std::find(watches.begin(),watches.end(),polled[ix]) == watches.end()) {
+						continue;
+					}
+				}
+
+				unsigned int flags = 0;
+				if(revents & POLLIN) {
+					flags |= DBUS_WATCH_READABLE;
+				}
+				if(revents & POLLOUT) {
+					flags |= DBUS_WATCH_WRITABLE;
+				}
+				if(revents & POLLERR) {
+					flags |= DBUS_WATCH_ERROR;
+				}
+				if(revents & POLLHUP) {
+					flags |= DBUS_WATCH_HANGUP;
+				}
+
+				dbus_watch_handle(polled[ix],flags);
+
+			}
+
+			std::vector<Timeout *> expired;
+			{
+				lock_guard<mutex> lock(guard);
+				auto now = std::chrono::steady_clock::now();
+				while(!timeouts.empty() && timeouts.begin()->first <= now) {
+					Timeout *node = timeouts.begin()->second;
+					timeouts.erase(timeouts.begin());
+					node->scheduled = false;
+					node->firing = true;
+					expired.push_back(node);
+				}
+			}
+
+			// Without the guard, the handlers can add, remove or toggle timeouts.
+			for(Timeout *node : expired) {
+
+				DBusTimeout *handle;
+				{
+					lock_guard<mutex> lock(guard);
+					handle = node->timeout;
+				}
+
+				if(handle) {
+					dbus_timeout_handle(handle);
+				}
+
+			}
+
+			lock_guard<mutex> lock(guard);
+			for(Timeout *node : expired) {
+				node->firing = false;
+				if(!node->timeout) {
+					// Removed by the handler.
+					delete node;
+				} else if(!node->scheduled) {
+					// D-Bus timeouts are periodic until removed or disabled.
+					schedule(node);
+				}
+			}
+
+		}
+
+	};
+
+	void DBus::Connection::dispatch(const std::shared_ptr<const Member> &member, const std::shared_ptr<const Arguments> &arguments) {
+
+		if(marshal && marshal->members) {
+			marshal->push_back([member,arguments](){
+				member->dispatch(arguments);
+			});
+			return;
+		}
+
+		member->dispatch(arguments);
+
+	}
+
+	void DBus::Connection::start(bool mainloop) {
+
+		lock_guard<mutex> lock(guard);
+
+		if(thread) {
+			return;
+		}
+
+		Logger::String{"Starting service thread"}.trace(name());
+
+		auto events = make_shared<Loop>();
+		marshal = make_shared<Marshal>(mainloop);
+
+		// The service thread owns the socket and the timeouts.
+		mainloop_remove_timeouts(conn);
+		mainloop_watch_remove(conn);
+		events->attach(conn);
+		loop = events;
+
+		running = true;
+		thread = new std::thread([this](){
+			run();
+		});
+
+	}
+
+	void DBus::Connection::stop() {
+
+		std::thread *service;
+
+		{
+			lock_guard<mutex> lock(guard);
+			if(!thread) {
+				return;
+			}
+
+			running = false;
+			loop->wakeup();
+
+			if(thread->get_id() == std::this_thread::get_id()) {
+				// Called from a callback, the thread can't join itself; finish on the main loop.
+				Logger::String{"Stopping service thread from the main loop"}.trace(name());
+				marshal->push_back([this](){
+					stop();
+				});
+				return;
+			}
+
+			service = thread;
+			thread = nullptr;
+		}
+
+		Logger::String{"Stopping service thread"}.trace(name());
+
+		service->join();
+		delete service;
+
+		// Back to the main loop.
+		loop->detach(conn);
+		mainloop_add_timeouts(conn);
+		mainloop_watch_add(conn);
+
+		lock_guard<mutex> lock(guard);
+		marshal.reset();
+		loop.reset();
+
+	}
+
+	void DBus::Connection::run() noexcept {
+
+		dbus_connection_ref(conn);
+
+		// Sleeps until there's something to do, stop() wakes it up.
+		while(running) {
+
+			while(running && dbus_connection_dispatch(conn) == DBUS_DISPATCH_DATA_REMAINS);
+
+			if(!dbus_connection_get_is_connected(conn)) {
+				Logger::String{"Disconnected, stopping service thread"}.warning(name());
+				break;
+			}
+
+			if(!running) {
+				break;
+			}
+
+			try {
+				loop->wait();
+			} catch(const std::exception &e) {
+				Logger::String{e.what(),", stopping service thread"}.error(name());
+				break;
+			}
+
+		}
+
+		dbus_connection_unref(conn);
+
+	}
+
+ }
+
@@ -0,0 +1,280 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ /**
+  * @brief Implements the per-destination concurrency limit.
+  */
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <udjat/tools/dbus/connection.h>
+ #include <private/pending.h>
+ #include <private/throttle.h>
+ #include <cstring>
+ #include <algorithm>
+ #include <vector>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	DBus::Throttle::Throttle(unsigned int l) : limit{l} {
+	}
+
+	DBus::Throttle::~Throttle() {
+		disable();
+	}
+
+	/// @brief Get the time a queued call expires, by its timeout or deadline.
+	static std::chrono::steady_clock::time_point expiration(const std::chrono::steady_clock::time_point &now, const DBus::Deadline::TimePoint &deadline, int timeout) {
+
+		if(timeout == DBUS_TIMEOUT_USE_DEFAULT) {
+			timeout = DBus::Deadline::default_timeout;
+		}
+
+		if(timeout == DBUS_TIMEOUT_INFINITE) {
+			return deadline;
+		}
+
+		return std::min(deadline,now + std::chrono::milliseconds(timeout));
+
+	}
+
+	bool DBus::Throttle::acquire(DBusConnection *conn, DBusMessage *message, PendingCall *record, int timeout) {
+
+		const char *destination = dbus_message_get_destination(message);
+		if(!destination || strcmp(destination,DBUS_SERVICE_DBUS) == 0) {
+			// The bus daemon is never throttled.
+			return true;
+		}
+
+		Queued entry;
+
+		{
+			lock_guard<mutex> lock(guard);
+
+			Lane &lane = lanes[destination];
+
+			if(lane.destination.empty()) {
+				lane.destination = destination;
+			}
+
+			if(lane.statistics.in_flight < limit) {
+				lane.statistics.in_flight++;
+				if(lane.statistics.in_flight > lane.statistics.max_in_flight) {
+					lane.statistics.max_in_flight = lane.statistics.in_flight;
+				}
+				record->throttle = shared_from_this();
+				record->lane = &lane;
+				return true;
+			}
+
+			entry.conn = dbus_connection_ref(conn);
+			entry.message = dbus_message_ref(message);
+			entry.record = record;
+			entry.timeout = timeout;
+			entry.enqueued = std::chrono::steady_clock::now();
+			entry.expires = expiration(entry.enqueued,record->deadline,timeout);
+			lane.queue.push_back(entry);
+
+			lane.statistics.queued = lane.queue.size();
+			if(lane.statistics.queued > lane.statistics.max_queued) {
+				lane.statistics.max_queued = lane.statistics.queued;
+			}
+
+			if(entry.expires >= armed) {
+				// The timer will fire before this one expires.
+				return false;
+			}
+			armed = entry.expires;
+		}
+
+		arm(entry.expires);
+		return false;
+
+	}
+
+	void DBus::Throttle::arm(const std::chrono::steady_clock::time_point &expires) {
+
+		// Round up, don't fire before the expiration.
+		auto now = std::chrono::steady_clock::now();
+		unsigned long milliseconds = 1;
+		if(expires > now) {
+			milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(expires - now + std::chrono::microseconds(999)).count();
+		}
+
+		reset(milliseconds);
+		enable();
+		MainLoop::getInstance().wakeup();
+
+	}
+
+	void DBus::Throttle::on_timer() {
+
+		// The callbacks can replace the connection limit, releasing this one.
+		auto self = shared_from_this();
+
+		std::vector<Queued> expired;
+		auto next = std::chrono::steady_clock::time_point::max();
+
+		{
+			lock_guard<mutex> lock(guard);
+
+			auto now = std::chrono::steady_clock::now();
+
+			for(auto &it : lanes) {
+
+				Lane &lane = it.second;
+
+				for(auto entry = lane.queue.begin(); entry != lane.queue.end();) {
+					if(entry->expires <= now) {
+						expired.push_back(*entry);
+						entry = lane.queue.erase(entry);
+						lane.statistics.expired++;
+					} else {
+						next = std::min(next,entry->expires);
+						entry++;
+					}
+				}
+
+				lane.statistics.queued = lane.queue.size();
+
+			}
+
+			armed = next;
+		}
+
+		if(next == std::chrono::steady_clock::time_point::max()) {
+			disable();
+		} else {
+			arm(next);
+		}
+
+		for(auto &entry : expired) {
+
+			dbus_message_unref(entry.message);
+			dbus_connection_unref(entry.conn);
+
+			// Never sent, the circuit breaker doesn't get a result.
+			PendingCall::fail(entry.record,DBUS_ERROR_NO_REPLY,"The call expired waiting for a free slot");
+
+		}
+
+	}
+
+	bool DBus::Throttle::next(Lane *lane, Queued &entry) noexcept {
+
+		lock_guard<mutex> lock(guard);
+
+		if(lane->queue.empty()) {
+
+			if(--lane->statistics.in_flight == 0) {
+
+				// Idle, keep the counters for the totals and remove it.
+				const auto &statistics = lane->statistics;
+				retired.max_in_flight = std::max(retired.max_in_flight,statistics.max_in_flight);
+				retired.max_queued = std::max(retired.max_queued,statistics.max_queued);
+				retired.delayed += statistics.delayed;
+				retired.expired += statistics.expired;
+				retired.wait += statistics.wait;
+				retired.max_wait = std::max(retired.max_wait,statistics.max_wait);
+
+				lanes.erase(lane->destination);
+
+			}
+
+			return false;
+		}
+
+		// The slot goes to the oldest call.
+		entry = lane->queue.front();
+		lane->queue.pop_front();
+
+		auto wait = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - entry.enqueued);
+
+		lane->statistics.queued = lane->queue.size();
+		lane->statistics.delayed++;
+		lane->statistics.wait += wait;
+		if(wait > lane->statistics.max_wait) {
+			lane->statistics.max_wait = wait;
+		}
+
+		entry.record->throttle = shared_from_this();
+		entry.record->lane = lane;
+
+		return true;
+
+	}
+
+	DBus::Connection::QueueStatistics DBus::Throttle::statistics(const char *destination) noexcept {
+
+		lock_guard<mutex> lock(guard);
+
+		if(destination) {
+			auto it = lanes.find(destination);
+			if(it == lanes.end()) {
+				return Connection::QueueStatistics{};
+			}
+			return it->second.statistics;
+		}
+
+		Connection::QueueStatistics totals{retired};
+		for(const auto &it : lanes) {
+			const auto &statistics = it.second.statistics;
+			totals.in_flight += statistics.in_flight;
+			totals.queued += statistics.queued;
+			totals.max_in_flight = std::max(totals.max_in_flight,statistics.max_in_flight);
+			totals.max_queued = std::max(totals.max_queued,statistics.max_queued);
+			totals.delayed += statistics.delayed;
+			totals.expired += statistics.expired;
+			totals.wait += statistics.wait;
+			totals.max_wait = std::max(totals.max_wait,statistics.max_wait);
+		}
+
+		return totals;
+
+	}
+
+	void DBus::Connection::max_in_flight(unsigned int limit) {
+
+		std::shared_ptr<Throttle> limiter;
+		if(limit) {
+			limiter = make_shared<Throttle>(limit);
+		}
+
+		// The previous one is released by the last pending call using it.
+		std::atomic_store(&throttle,limiter);
+
+	}
+
+	DBus::Connection::QueueStatistics DBus::Connection::queue_statistics(const char *destination) const noexcept {
+
+		auto limiter = std::atomic_load(&throttle);
+		if(!limiter) {
+			return QueueStatistics{};
+		}
+
+		return limiter->statistics(destination);
+
+	}
+
+ }
+
@@ -17,72 +17,413 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+ /**
+  * @brief Implements d-bus timeouts on a hierarchical timer wheel.
+  */
+
  #include <config.h>
  #include <udjat/defs.h>
  #include <udjat/tools/mainloop.h>
  #include <udjat/tools/timer.h>
  #include <private/mainloop.h>
  #include <unistd.h>
+ #include <mutex>
+ #include <vector>
+ #include <memory>
+ #include <chrono>
 
- class TimeoutContext : public Udjat::MainLoop::Timer {
+ /// @brief Timer wheel for all d-bus timeouts, driven by a single main loop timer.
+ /// @details Nodes are kept on intrusive lists, add, cancel and expire are O(1); nodes
+ /// are recycled from a pool, so pending calls don't allocate timers.
+ class TimerWheel : public Udjat::MainLoop::Timer {
  public:
 
-	DBusConnection	* conn = nullptr;
-	DBusTimeout		* timeout = nullptr;
+	/// @brief Wheel resolution in milliseconds.
+	static constexpr unsigned long tick = 10;
+
+	struct Node {
+		DBusTimeout * timeout = nullptr;
+		uint64_t expires = 0;			///< @brief Expiration tick.
+		Node * prev = nullptr;
+		Node * next = nullptr;
+		Node ** slot = nullptr;			///< @brief Slot head, nullptr if not scheduled.
+		bool firing = false;			///< @brief True while the timeout handler is running.
+	};
+
+ private:
+
+	static constexpr unsigned int bits = 6;
+	static constexpr uint64_t slots = (1 << bits);
+	static constexpr uint64_t mask = slots - 1;
+	static constexpr unsigned int levels = 4;
+
+	/// @brief Longest interval, in ticks (about 46 hours).
+	static constexpr uint64_t limit = (((uint64_t) 1) << (bits * levels)) - 1;
+
+	std::mutex guard;
+
+	Node * wheel[levels][slots];
+
+	/// @brief Last processed tick.
+	uint64_t current = 0;
+
+	/// @brief Tick of the next main loop timer event.
+	uint64_t wakeup = 0;
+
+	/// @brief True if the main loop timer is enabled.
+	bool armed = false;
+
+	/// @brief Number of scheduled nodes.
+	size_t count = 0;
+
+	const std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+	/// @brief Released nodes.
+	Node * available = nullptr;
+	std::vector<std::unique_ptr<Node[]>> blocks;
+
+	/// @brief Nodes expired on the last pass, kept while firing.
+	std::vector<Node *> expired;
+
+	TimerWheel() {
+		for(auto &level : wheel) {
+			for(auto &slot : level) {
+				slot = nullptr;
+			}
+		}
+	}
+
+	inline uint64_t now() const noexcept {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count() / tick;
+	}
+
+	static inline uint64_t ticks(DBusTimeout *timeout) noexcept {
+		int interval = dbus_timeout_get_interval(timeout);
+		if(interval <= 0) {
+			return 1;
+		}
+		return (((uint64_t) interval) + tick - 1) / tick;
+	}
+
+	Node * allocate() {
+
+		if(!available) {
+			// Grow the pool by blocks, nodes are never released to the heap.
+			static constexpr size_t block = 256;
+			Node *nodes = new Node[block];
+			blocks.emplace_back(nodes);
+			for(size_t ix = 0; ix < block; ix++) {
+				nodes[ix].next = available;
+				available = nodes+ix;
+			}
+		}
+
+		Node *node = available;
+		available = node->next;
+		*node = Node{};
+		return node;
+
+	}
+
+	void release(Node *node) noexcept {
+		node->timeout = nullptr;
+		node->next = available;
+		available = node;
+	}
+
+	void link(Node *node) noexcept {
+
+		if(node->expires < current) {
+			node->expires = current;
+		} else if(node->expires - current > limit) {
+			node->expires = current + limit;
+		}
+
+		uint64_t delta = node->expires - current;
+
+		unsigned int level = 0;
+		while(level < (levels-1) && delta >= (((uint64_t) 1) << (bits * (level+1)))) {
+			level++;
+		}
+
+		Node **slot = &wheel[level][(node->expires >> (bits * level)) & mask];
+
+		node->slot = slot;
+		node->prev = nullptr;
+		node->next = *slot;
+		if(*slot) {
+			(*slot)->prev = node;
+		}
+		*slot = node;
+
+		count++;
+
+	}
+
+	void unlink(Node *node) noexcept {
+
+		if(!node->slot) {
+			return;
+		}
+
+		if(node->prev) {
+			node->prev->next = node->next;
+		} else {
+			*node->slot = node->next;
+		}
+
+		if(node->next) {
+			node->next->prev = node->prev;
+		}
+
+		node->slot = nullptr;
+		node->prev = node->next = nullptr;
+
+		count--;
+
+	}
+
+	/// @brief Move the nodes from a higher level slot to the lower ones.
+	void cascade(unsigned int level) noexcept {
+
+		Node *node = wheel[level][(current >> (bits * level)) & mask];
+		wheel[level][(current >> (bits * level)) & mask] = nullptr;
+
+		while(node) {
+			Node *next = node->next;
+			node->slot = nullptr;
+			count--;
+			link(node);
+			node = next;
+		}
+
+	}
+
+	/// @brief Get the number of ticks until the next event.
+	uint64_t idle() const noexcept {
+
+		for(uint64_t ix = 1; ix < slots; ix++) {
+			if(wheel[0][(current + ix) & mask]) {
+				return ix;
+			}
+		}
+
+		// Nothing on the first level, wake up for the next cascade.
+		return slots - (current & mask);
+
+	}
+
+	/// @brief Stop the main loop timer, requires the guard.
+	void stop() noexcept {
+		armed = false;
+		disable();
+	}
+
+	/// @brief Schedule the main loop timer, requires the guard.
+	void schedule() {
+
+		if(!count) {
+			stop();
+			return;
+		}
+
+		uint64_t next = current + idle();
+		uint64_t from = now();
+
+		if(armed && next >= wakeup && wakeup > from) {
+			// Already scheduled on time.
+			return;
+		}
+
+		wakeup = next;
+		armed = true;
+		reset(next > from ? (next - from) * tick : tick);
+		enable();
 
-	TimeoutContext() {
 	}
 
  protected:
-	void on_timer() override {
-		dbus_timeout_handle(this->timeout);
+
+	void on_timer() override;
+
+ public:
+
+	static TimerWheel & getInstance() {
+		static TimerWheel instance;
+		return instance;
+	}
+
+	virtual ~TimerWheel() {
+		disable();
 	}
 
+	/// @brief Get node for the timeout, schedule it if enabled.
+	Node * insert(DBusTimeout *timeout);
+
+	/// @brief Cancel and release the node.
+	void remove(Node *node) noexcept;
+
+	/// @brief Reschedule the node after the timeout was enabled or disabled.
+	void toggle(Node *node);
+
  };
 
- dbus_bool_t add_timeout(DBusTimeout *t, DBusConnection *connection) {
+ TimerWheel::Node * TimerWheel::insert(DBusTimeout *timeout) {
 
-	TimeoutContext *ctx = new TimeoutContext();
+	std::lock_guard<std::mutex> lock(guard);
 
-	ctx->conn		= connection;
-	ctx->timeout	= t;
-	ctx->reset(dbus_timeout_get_interval(t));
+	if(!count) {
+		// The wheel is empty, just move it forward.
+		current = now();
+	}
 
-	dbus_timeout_set_data(t, ctx, NULL);
+	Node *node = allocate();
+	node->timeout = timeout;
 
-	if(dbus_timeout_get_enabled(ctx->timeout)) {
-		ctx->enable();
+	if(dbus_timeout_get_enabled(timeout)) {
+		node->expires = now() + ticks(timeout);
+		link(node);
+		schedule();
 	}
 
-	return TRUE;
+	return node;
+
  }
 
- void remove_timeout(DBusTimeout *t, DBusConnection *) {
+ void TimerWheel::remove(Node *node) noexcept {
 
-	TimeoutContext *ctx = (TimeoutContext *) dbus_timeout_get_data(t);
+	std::lock_guard<std::mutex> lock(guard);
 
-	if(ctx) {
-		delete ctx;
+	unlink(node);
+
+	if(node->firing) {
+		// Released by on_timer() after the handler returns.
+		node->timeout = nullptr;
+	} else {
+		release(node);
 	}
+
+	if(!count) {
+		stop();
+	}
+
  }
 
- void toggle_timeout(DBusTimeout *t, DBusConnection *) {
+ void TimerWheel::toggle(Node *node) {
+
+	std::lock_guard<std::mutex> lock(guard);
 
-	TimeoutContext *ctx = (TimeoutContext *) dbus_timeout_get_data(t);
+	unlink(node);
+
+	if(node->firing) {
+		// Rescheduled by on_timer() after the handler returns.
+		return;
+	}
+
+	if(dbus_timeout_get_enabled(node->timeout)) {
+		if(!count) {
+			current = now();
+		}
+		node->expires = now() + ticks(node->timeout);
+		link(node);
+	}
+
+	schedule();
+
+ }
 
-	if(ctx) {
+ void TimerWheel::on_timer() {
 
-		ctx->disable();
+	{
+		std::lock_guard<std::mutex> lock(guard);
 
-		if (dbus_timeout_get_enabled(ctx->timeout)) {
+		expired.clear();
 
-			ctx->reset(dbus_timeout_get_interval(ctx->timeout));
-			ctx->enable();
+		for(uint64_t target = now(); current < target;) {
 
+			current++;
+
+			// Refill the lower levels on every wrap.
+			for(unsigned int level = 1; level < levels; level++) {
+				if((current >> (bits * (level-1))) & mask) {
+					break;
+				}
+				cascade(level);
+			}
+
+			Node *node = wheel[0][current & mask];
+			while(node) {
+				Node *next = node->next;
+				unlink(node);
+				node->firing = true;
+				expired.push_back(node);
+				node = next;
+			}
+
+		}
+
+	}
+
+	// Without the guard, the handlers can add, remove or toggle timeouts.
+	for(Node *node : expired) {
+
+		DBusTimeout *timeout;
+		{
+			// Another handler or thread could have removed it since the pass.
+			std::lock_guard<std::mutex> lock(guard);
+			timeout = node->timeout;
+		}
+
+		if(timeout) {
+			dbus_timeout_handle(timeout);
+		}
+
+	}
+
+	std::lock_guard<std::mutex> lock(guard);
+
+	for(Node *node : expired) {
+
+		node->firing = false;
+
+		if(!node->timeout) {
+			// Removed by the handler.
+			release(node);
+		} else if(!node->slot && dbus_timeout_get_enabled(node->timeout)) {
+			// D-Bus timeouts are periodic until removed or disabled.
+			node->expires = current + ticks(node->timeout);
+			link(node);
 		}
 
 	}
 
+	expired.clear();
+	schedule();
+
+ }
+
+ dbus_bool_t add_timeout(DBusTimeout *t, DBusConnection *) {
+	dbus_timeout_set_data(t, TimerWheel::getInstance().insert(t), NULL);
+	return TRUE;
+ }
+
+ void remove_timeout(DBusTimeout *t, DBusConnection *) {
+
+	TimerWheel::Node *node = (TimerWheel::Node *) dbus_timeout_get_data(t);
+
+	if(node) {
+		dbus_timeout_set_data(t, NULL, NULL);
+		TimerWheel::getInstance().remove(node);
+	}
  }
 
+ void toggle_timeout(DBusTimeout *t, DBusConnection *) {
+
+	TimerWheel::Node *node = (TimerWheel::Node *) dbus_timeout_get_data(t);
+
+	if(node) {
+		TimerWheel::getInstance().toggle(node);
+	}
+
+ }
 
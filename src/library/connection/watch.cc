@@ -19,14 +19,112 @@
 
  #include <udjat/defs.h>
  #include <private/mainloop.h>
+ #include <private/dataslot.h>
  #include <udjat/module/abstract.h>
  #include <udjat/tools/mainloop.h>
  #include <udjat/tools/handler.h>
  #include <udjat/tools/logger.h>
  #include <unistd.h>
+ #include <atomic>
 
 /*---[ Implement ]----------------------------------------------------------------------------------*/
 
+ /// @brief Dispatch incoming messages with a budget, the leftovers are handled on the next main loop pass.
+ class Dispatcher : public MainLoop::Timer {
+ private:
+	DBusConnection * connection = nullptr;
+
+	/// @brief True if there's a main loop pass already scheduled.
+	std::atomic<bool> scheduled{false};
+
+ protected:
+	void on_timer() override {
+		disable();
+		scheduled = false;
+		dispatch();
+	}
+
+ public:
+
+	static constexpr size_t default_budget = 64;
+
+	/// @brief Maximum number of messages on each pass, 0 for unlimited.
+	std::atomic<size_t> budget{default_budget};
+
+	struct {
+		std::atomic<size_t> wakeups{0};
+		std::atomic<size_t> messages{0};
+		std::atomic<size_t> exhausted{0};
+		std::atomic<size_t> coalesced{0};
+	} counters;
+
+	Dispatcher(DBusConnection *c) : connection{c} {
+	}
+
+	virtual ~Dispatcher() {
+		disable();
+	}
+
+	static DataSlot & slot() {
+		static DataSlot instance;
+		return instance;
+	}
+
+	static Dispatcher * getInstance(DBusConnection *connection) {
+		return (Dispatcher *) dbus_connection_get_data(connection,slot().value());
+	}
+
+	void dispatch();
+
+	/// @brief Run dispatch on the next main loop pass, from any thread.
+	/// @details Requests are coalesced, a burst of them wakes the main loop only once.
+	void schedule() noexcept;
+
+ };
+
+ void Dispatcher::schedule() noexcept {
+
+	if(scheduled.exchange(true)) {
+		counters.coalesced++;
+		return;
+	}
+
+	reset(0);
+	enable();
+	MainLoop::getInstance().wakeup();
+
+ }
+
+ void Dispatcher::dispatch() {
+
+	counters.wakeups++;
+
+	dbus_connection_ref(connection);
+
+	size_t count = 0;
+	size_t limit = budget;
+
+	while(dbus_connection_get_dispatch_status(connection) == DBUS_DISPATCH_DATA_REMAINS) {
+
+		if(limit && count >= limit) {
+			// Out of budget, let the other handlers run and continue on the next pass.
+			counters.exhausted++;
+			schedule();
+			break;
+		}
+
+		dbus_connection_dispatch(connection);
+		count++;
+
+	}
+
+	counters.messages += count;
+
+	// Can release the last reference (and this object), don't touch it after this.
+	dbus_connection_unref(connection);
+
+ }
+
  class Context : public MainLoop::Handler {
  private:
 
@@ -124,8 +222,17 @@
 
  }
 
- void wake_up(DBusConnection *) {
-	MainLoop::getInstance().wakeup();
+ void wake_up(Dispatcher *dispatcher) {
+	// Called from any thread, usually with the connection locked.
+	dispatcher->schedule();
+ }
+
+ void handle_dispatch_status(DBusConnection *, DBusDispatchStatus status, Dispatcher *dispatcher) {
+	// Messages queued outside the main loop (by a blocking call in another
+	// thread, for example) would wait for the next socket event without this.
+	if(status == DBUS_DISPATCH_DATA_REMAINS) {
+		dispatcher->schedule();
+	}
  }
 
  void Context::handle_event(const MainLoop::Handler::Event events) {
@@ -181,10 +288,10 @@
 		return;
 	}
 
-	dbus_connection_ref(connection);
-	while (dbus_connection_get_dispatch_status(connection) == DBUS_DISPATCH_DATA_REMAINS)
-        dbus_connection_dispatch(connection);
-	dbus_connection_unref(connection);
+	Dispatcher *dispatcher = Dispatcher::getInstance(connection);
+	if(dispatcher) {
+		dispatcher->dispatch();
+	}
 
  }
 
@@ -193,19 +300,26 @@
 	// Initialize Main loop.
 	MainLoop::getInstance().type();
 
-	// Set watch functions.
-	if(!dbus_connection_set_watch_functions(
+	// Set dispatcher, released with the connection or by mainloop_remove().
+	Dispatcher *dispatcher = new Dispatcher(conn);
+	if(!dbus_connection_set_data(
 		conn,
-		(DBusAddWatchFunction) add_watch,
-		(DBusRemoveWatchFunction) remove_watch,
-		(DBusWatchToggledFunction) toggle_watch,
-		conn,
-		nullptr)
+		Dispatcher::slot().value(),
+		dispatcher,
+		[](void *dispatcher){
+			delete ((Dispatcher *) dispatcher);
+		})
 	) {
-		throw runtime_error("dbus_connection_set_watch_functions has failed");
+		throw runtime_error("dbus_connection_set_data has failed");
 	}
 
-	// Set timeout functions.
+	mainloop_add_timeouts(conn);
+	mainloop_watch_add(conn);
+
+ }
+
+ void mainloop_add_timeouts(DBusConnection *conn) {
+
 	if(!dbus_connection_set_timeout_functions(
 		conn,
 		(DBusAddTimeoutFunction) add_timeout,
@@ -217,16 +331,65 @@
 		throw runtime_error("dbus_connection_set_timeout_functions has failed");
 	}
 
+ }
+
+ void mainloop_remove_timeouts(DBusConnection *conn) {
+
+	if(!dbus_connection_set_timeout_functions(
+		conn,
+		(DBusAddTimeoutFunction) NULL,
+		(DBusRemoveTimeoutFunction) NULL,
+		(DBusTimeoutToggledFunction) NULL,
+		NULL,
+		nullptr)
+	) {
+		Logger::String{"dbus_connection_set_timeout_functions failed"}.error("d-bus");
+	}
+
+ }
+
+ void mainloop_watch_add(DBusConnection *conn) {
+
+	Dispatcher *dispatcher = Dispatcher::getInstance(conn);
+	if(!dispatcher) {
+		// Not attached by mainloop_add() or already removed.
+		return;
+	}
+
+	// Set watch functions.
+	if(!dbus_connection_set_watch_functions(
+		conn,
+		(DBusAddWatchFunction) add_watch,
+		(DBusRemoveWatchFunction) remove_watch,
+		(DBusWatchToggledFunction) toggle_watch,
+		conn,
+		nullptr)
+	) {
+		throw runtime_error("dbus_connection_set_watch_functions has failed");
+	}
+
 	dbus_connection_set_wakeup_main_function(
 		conn,
 		(DBusWakeupMainFunction) wake_up,
+		dispatcher,
+		NULL
+	);
+
+	dbus_connection_set_dispatch_status_function(
 		conn,
+		(DBusDispatchStatusFunction) handle_dispatch_status,
+		dispatcher,
 		NULL
 	);
 
+	// Messages received before the bindings were set.
+	if(dbus_connection_get_dispatch_status(conn) == DBUS_DISPATCH_DATA_REMAINS) {
+		dispatcher->schedule();
+	}
+
  }
 
- void mainloop_remove(DBusConnection *conn) {
+ void mainloop_watch_remove(DBusConnection *conn) {
 
 	if(!dbus_connection_set_watch_functions(
 		conn,
@@ -239,15 +402,45 @@
 		Logger::String{"dbus_connection_set_watch_functions failed"}.error("d-bus");
 	}
 
-	if(!dbus_connection_set_timeout_functions(
-		conn,
-		(DBusAddTimeoutFunction) NULL,
-		(DBusRemoveTimeoutFunction) NULL,
-		(DBusTimeoutToggledFunction) NULL,
-		NULL,
-		nullptr)
-	) {
-		Logger::String{"dbus_connection_set_timeout_functions failed"}.error("d-bus");
+	dbus_connection_set_wakeup_main_function(conn,NULL,NULL,NULL);
+	dbus_connection_set_dispatch_status_function(conn,NULL,NULL,NULL);
+
+ }
+
+ void mainloop_remove(DBusConnection *conn) {
+
+	mainloop_watch_remove(conn);
+	mainloop_remove_timeouts(conn);
+
+	dbus_connection_set_data(conn,Dispatcher::slot().value(),NULL,NULL);
+
+ }
+
+ namespace Udjat {
+
+	DBus::Connection::Statistics DBus::Connection::statistics() const noexcept {
+
+		Statistics stats;
+
+		Dispatcher *dispatcher = (conn ? Dispatcher::getInstance(conn) : nullptr);
+		if(dispatcher) {
+			stats.wakeups = dispatcher->counters.wakeups;
+			stats.messages = dispatcher->counters.messages;
+			stats.exhausted = dispatcher->counters.exhausted;
+			stats.coalesced = dispatcher->counters.coalesced;
+		}
+
+		return stats;
+
+	}
+
+	void DBus::Connection::dispatch_budget(size_t messages) noexcept {
+
+		Dispatcher *dispatcher = (conn ? Dispatcher::getInstance(conn) : nullptr);
+		if(dispatcher) {
+			dispatcher->budget = messages;
+		}
+
 	}
 
  }
@@ -20,9 +20,13 @@
  #include <config.h>
  #include <udjat/defs.h>
  #include <udjat/tools/dbus/interface.h>
+ #include <udjat/tools/dbus/connection.h>
  #include <udjat/tools/string.h>
  #include <udjat/tools/logger.h>
  #include <stdexcept>
+ #include <mutex>
+ #include <memory>
+ #include <private/arguments.h>
 
  using namespace std;
 
@@ -89,28 +93,60 @@
 		return strcasecmp(intf,c_str()) == 0;
 	}
 
+	Udjat::DBus::Member & DBus::Interface::insert(std::shared_ptr<Udjat::DBus::Member> member) {
+
+		if(connection) {
+			// Attached interface, serialize with the connection and publish a new dispatch table.
+			lock_guard<mutex> lock(connection->guard);
+			members.push_back(member);
+			connection->index(*this,member);
+		} else {
+			members.push_back(member);
+		}
+
+		return *member;
+	}
+
 	Udjat::DBus::Member & DBus::Interface::push_back(const XML::Node &node,const std::function<bool(Udjat::DBus::Message & message)> &callback) {
-#if __cplusplus >= 201703	
-		return members.emplace_back(node,callback);
-#else
-		members.emplace_back(node,callback);
-		return members.back();
-#endif
+		return insert(make_shared<Udjat::DBus::Member>(node,callback));
 	}
 
-	Udjat::DBus::Member & DBus::Interface::emplace_back(const char *member, const std::function<bool(Udjat::DBus::Message & message)> &callback) {
-#if __cplusplus >= 201703	
-		return members.emplace_back(member,callback);
-#else
-		members.emplace_back(member,callback);
-		return members.back();
-#endif
+	Udjat::DBus::Member & DBus::Interface::emplace_back(const char *name, const std::function<bool(Udjat::DBus::Message & message)> &callback, const Udjat::DBus::Member::Mode mode) {
+		return insert(make_shared<Udjat::DBus::Member>(name,callback,mode));
+	}
+
+	Udjat::DBus::Member & DBus::Interface::emplace_back(const char *name, const Udjat::DBus::Member::Match &match, const std::function<bool(Udjat::DBus::Message & message)> &callback, const Udjat::DBus::Member::Mode mode) {
+		return insert(make_shared<Udjat::DBus::Member>(name,match,callback,mode));
 	}
 
 	void DBus::Interface::remove(const Udjat::DBus::Member &member) {
-		members.remove_if([&member](Udjat::DBus::Member &m){
-			return &m == &member;
-		});
+
+		// Keep the member alive until it's cancelled, the list may hold the last reference.
+		std::shared_ptr<Udjat::DBus::Member> removed;
+
+		auto remove = [this,&member,&removed](){
+			members.remove_if([&member,&removed](std::shared_ptr<Udjat::DBus::Member> &m){
+				if(m.get() == &member) {
+					removed = m;
+					return true;
+				}
+				return false;
+			});
+		};
+
+		if(connection) {
+			lock_guard<mutex> lock(connection->guard);
+			connection->unindex(*this,member);
+			remove();
+		} else {
+			remove();
+		}
+
+		// Without the guard, the running callback can use it.
+		if(removed) {
+			removed->cancel();
+		}
+
 	}
 
 	DBusHandlerResult DBus::Interface::filter(DBusMessage *message) const {
@@ -118,11 +154,21 @@
 		int type = dbus_message_get_type(message);
 		const char *name = dbus_message_get_member(message);
 
+		std::shared_ptr<const Arguments> arguments;
+
 		for(auto &member : members) {
 
-			if(member == type && member == name) {
-				Udjat::DBus::Message msg(message);
-				member.call(msg);
+			if(!(*member == type && *member == name)) {
+				continue;
+			}
+
+			if(!arguments) {
+				arguments = make_shared<const Arguments>(message);
+			}
+
+			if(member->matches(*arguments)) {
+				Udjat::DBus::Message msg(arguments);
+				member->call(msg);
 			}
 
 		}
@@ -28,6 +28,10 @@
  #include <udjat/tools/string.h>
  #include <udjat/tools/logger.h>
  #include <udjat/tools/xml.h>
+ #include <private/workerpool.h>
+ #include <private/arguments.h>
+ #include <mutex>
+ #include <algorithm>
 
  using namespace std;
 
@@ -51,12 +55,40 @@
 		throw runtime_error("Member name attribute is missing or invalid");
 	}
 
-	DBus::Member::Member(const char *name,const std::function<bool(Message & message)> &c)
-		: string{name}, callback{c}, type{DBUS_MESSAGE_TYPE_SIGNAL} {
+	DBus::Member::Member(const char *name,const std::function<bool(Message & message)> &c, const Mode m)
+		: string{name}, callback{c}, type{DBUS_MESSAGE_TYPE_SIGNAL}, mode{m} {
 		Logger::String{"Watching '",c_str(),"'"}.trace("d-bus");
 	}
 
-	DBus::Member::Member(const XML::Node &node,const std::function<bool(Message & message)> &callback) : Member{NameFactory(node).c_str(),callback} {
+	DBus::Member::Member(const char *name, const Match &m, const std::function<bool(Message & message)> &c, const Mode md)
+		: Member{name,c,md} {
+		match = m;
+		std::sort(match.args.begin(),match.args.end());
+	}
+
+	DBus::Member::Match::Match(const XML::Node &node)
+		: sender{String{node,"dbus-sender"}}, path{String{node,"dbus-path"}}, path_namespace{String{node,"dbus-path-namespace"}} {
+
+		// D-Bus accepts arg0 to arg63.
+		for(unsigned int ix = 0; ix < 64; ix++) {
+			String value{node,String{"dbus-arg",ix}.c_str()};
+			if(!value.empty()) {
+				args.emplace_back(ix,value);
+			}
+		}
+
+	}
+
+	DBus::Member::Member(const XML::Node &node,const std::function<bool(Message & message)> &callback) : Member{NameFactory(node).c_str(),Match{node},callback} {
+
+		{
+			String dispatch{node,"dbus-dispatch","inline"};
+			if(!strcasecmp(dispatch.c_str(),"pool") || !strcasecmp(dispatch.c_str(),"thread-pool")) {
+				mode = Pooled;
+			} else if(strcasecmp(dispatch.c_str(),"inline")) {
+				throw runtime_error(String{"Unexpected dispatch mode '",dispatch.c_str(),"'"});
+			}
+		}
 
 		const char *name = XML::StringFactory(node,"dbus-message-type");
 
@@ -83,10 +115,225 @@
 		Logger::String{"Unwatching '",c_str(),"'"}.trace("d-bus");
 	}
 
+	void DBus::Member::invoke(const std::shared_ptr<const Arguments> &arguments) const noexcept {
+
+		DBusMessage *message = arguments->message();
+
+		try {
+
+			Message msg(arguments);
+			callback(msg);
+
+		} catch(const std::exception &e) {
+
+			Logger::String{
+				dbus_message_get_interface(message),
+				".",
+				dbus_message_get_member(message),
+				": ",
+				e.what()
+			}.error("d-bus");
+
+		} catch(...) {
+
+			Logger::String{
+				dbus_message_get_interface(message),
+				".",
+				dbus_message_get_member(message),
+				": Unexpected error",
+			}.error("d-bus");
+
+		}
+
+	}
+
+	void DBus::Member::dispatch(const std::shared_ptr<const Arguments> &arguments) const {
+
+		if(mode == Inline) {
+			Message msg(arguments);
+			callback(msg);
+			return;
+		}
+
+		// Pooled, queue the message; only one worker per member to keep the order.
+		lock_guard<mutex> lock(pending.guard);
+		if(pending.removed) {
+			return;
+		}
+		pending.messages.push_back(arguments);
+
+		if(!pending.busy) {
+			pending.busy = true;
+			auto self = shared_from_this();
+			WorkerPool::getInstance().push([self](){
+				self->drain();
+			});
+		}
+
+	}
+
+	void DBus::Member::drain() const noexcept {
+
+		// Release the worker after a few messages so busy members can't starve the others.
+		for(size_t count = 0; count < 16; count++) {
+
+			std::shared_ptr<const Arguments> arguments;
+
+			{
+				lock_guard<mutex> lock(pending.guard);
+				if(pending.removed || pending.messages.empty()) {
+					pending.busy = false;
+					return;
+				}
+				arguments = std::move(pending.messages.front());
+				pending.messages.pop_front();
+				pending.running = true;
+				pending.worker = std::this_thread::get_id();
+			}
+
+			invoke(arguments);
+
+			{
+				lock_guard<mutex> lock(pending.guard);
+				pending.running = false;
+			}
+			pending.idle.notify_all();
+
+		}
+
+		auto self = shared_from_this();
+		WorkerPool::getInstance().push([self](){
+			self->drain();
+		});
+
+	}
+
+	void DBus::Member::cancel() const noexcept {
+
+		unique_lock<mutex> lock(pending.guard);
+
+		pending.removed = true;
+		pending.messages.clear();
+
+		// The callback can unsubscribe itself, don't wait for it.
+		if(pending.running && pending.worker != std::this_thread::get_id()) {
+			pending.idle.wait(lock,[this]{ return !pending.running; });
+		}
+
+	}
+
 	bool DBus::Member::operator==(const char *name) const noexcept {
 		return strcasecmp(name,c_str()) == 0;
 	}
 
+	/// @brief Append 'key=value' to the match rule, escaping the value.
+	static void add_constraint(std::string &rule, const char *key, const char *value) {
+
+		rule += ",";
+		rule += key;
+		rule += "='";
+
+		for(const char *ptr = value; *ptr; ptr++) {
+			if(*ptr == '\'') {
+				// Close quote, escaped apostrophe, open quote.
+				rule += "'\\''";
+			} else {
+				rule += *ptr;
+			}
+		}
+
+		rule += "'";
+
+	}
+
+	std::string DBus::Member::rule(const char *interface) const {
+
+		std::string rule{"type='"};
+		rule += dbus_message_type_to_string(type);
+		rule += "'";
+
+		add_constraint(rule,"interface",interface);
+		add_constraint(rule,"member",c_str());
+
+		if(!match.sender.empty()) {
+			add_constraint(rule,"sender",match.sender.c_str());
+		}
+
+		if(!match.path.empty()) {
+			add_constraint(rule,"path",match.path.c_str());
+		}
+
+		if(!match.path_namespace.empty()) {
+			add_constraint(rule,"path_namespace",match.path_namespace.c_str());
+		}
+
+		for(const auto &arg : match.args) {
+			add_constraint(rule,String{"arg",arg.first}.c_str(),arg.second.c_str());
+		}
+
+		return rule;
+
+	}
+
+	bool DBus::Member::matches(const Arguments &arguments) const noexcept {
+
+		if(match.empty()) {
+			return true;
+		}
+
+		DBusMessage *message = arguments.message();
+
+		// Well-known names can't be checked here, only unique ones; the bus resolves the others.
+		if(!match.sender.empty() && match.sender[0] == ':') {
+			const char *sender = dbus_message_get_sender(message);
+			if(!(sender && match.sender == sender)) {
+				return false;
+			}
+		}
+
+		if(!match.path.empty() || !match.path_namespace.empty()) {
+
+			const char *path = dbus_message_get_path(message);
+			if(!path) {
+				return false;
+			}
+
+			if(!match.path.empty() && match.path != path) {
+				return false;
+			}
+
+			if(!match.path_namespace.empty() && match.path_namespace != "/") {
+				size_t length = match.path_namespace.size();
+				if(strncmp(path,match.path_namespace.c_str(),length) || !(path[length] == 0 || path[length] == '/')) {
+					return false;
+				}
+			}
+
+		}
+
+		for(const auto &arg : match.args) {
+
+			// Decoded once, shared with the other members.
+			if(arg.first >= arguments.size()) {
+				return false;
+			}
+
+			// argN only matches string arguments.
+			const auto &entry = arguments[arg.first];
+			if(entry.type != DBUS_TYPE_STRING) {
+				return false;
+			}
+
+			if(arg.second != entry.value.str) {
+				return false;
+			}
+
+		}
+
+		return true;
+
+	}
+
  }
 
 
@@ -0,0 +1,86 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+ /**
+  * @brief Implements the shared view of incoming message arguments.
+  */
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <private/arguments.h>
+ #include <cstring>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	DBus::Arguments::Arguments(DBusMessage *message) : msg{message} {
+		dbus_message_ref(msg);
+	}
+
+	DBus::Arguments::~Arguments() {
+		dbus_message_unref(msg);
+	}
+
+	const std::vector<DBus::Arguments::Entry> & DBus::Arguments::get() const {
+		// Pooled members can get here from several workers at once.
+		std::call_once(decoded,[this](){
+			decode();
+		});
+		return entries;
+	}
+
+	void DBus::Arguments::decode() const {
+
+		DBusMessageIter iter;
+		if(!dbus_message_iter_init(msg,&iter)) {
+			return;
+		}
+
+		int type;
+		while((type = dbus_message_iter_get_arg_type(&iter)) != DBUS_TYPE_INVALID) {
+
+			entries.emplace_back();
+			Entry &entry = entries.back();
+			memset(&entry.value,0,sizeof(entry.value));
+			entry.iter = iter;
+
+			DBusMessageIter sub = iter;
+			if(type == DBUS_TYPE_VARIANT) {
+				dbus_message_iter_recurse(&iter,&sub);
+				type = dbus_message_iter_get_arg_type(&sub);
+			}
+
+			entry.type = type;
+
+			// Reading a descriptor would dup it with nobody to close it, keep only the type.
+			if(dbus_type_is_basic(type) && type != DBUS_TYPE_UNIX_FD) {
+				// Strings point to the message body, valid while we keep the reference.
+				dbus_message_iter_get_basic(&sub,&entry.value);
+			}
+
+			dbus_message_iter_next(&iter);
+
+		}
+
+	}
+
+ }
+
@@ -0,0 +1,67 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ /**
+  * @brief Implements the signature checks for the typed marshalling.
+  */
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <dbus/dbus.h>
+ #include <udjat/tools/dbus/marshal.h>
+ #include <udjat/tools/string.h>
+ #include <system_error>
+ #include <cstring>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	void DBus::check_signature(DBusMessageIter *iter, const char *expected) {
+
+		if(dbus_message_iter_get_arg_type(iter) == DBUS_TYPE_INVALID) {
+			throw runtime_error("Empty message");
+		}
+
+		char *signature = dbus_message_iter_get_signature(iter);
+		bool match = (strcmp(signature,expected) == 0);
+
+		if(!match) {
+			String message{"Unexpected d-bus argument '",signature,"', expecting '",expected,"'"};
+			dbus_free(signature);
+			throw system_error(EINVAL,system_category(),message);
+		}
+
+		dbus_free(signature);
+
+	}
+
+	void DBus::check_signature(DBusMessage *message, const char *expected) {
+
+		const char *signature = dbus_message_get_signature(message);
+
+		if(strcmp(signature,expected)) {
+			throw system_error(EINVAL,system_category(),String{"Unexpected d-bus reply '",signature,"', expecting '",expected,"'"});
+		}
+
+	}
+
+ }
+
@@ -21,6 +21,7 @@
  #include <udjat/defs.h>
  #include <udjat/tools/logger.h>
  #include <udjat/tools/dbus/message.h>
+ #include <private/arguments.h>
  #include <iostream>
 
  using namespace std;
@@ -74,6 +75,52 @@
 
 	}
 
+	DBus::Message::Message(const std::shared_ptr<const Arguments> &arguments) {
+
+		DBusMessage *msg = arguments->message();
+
+		if(dbus_message_get_type(msg) == DBUS_MESSAGE_TYPE_ERROR) {
+
+			message.valid = false;
+			err.valid = true;
+			err.name = dbus_message_get_error_name(msg);
+
+			err.message.clear();
+			if(arguments->size() && (*arguments)[0].type == DBUS_TYPE_STRING) {
+				err.message = (*arguments)[0].value.str;
+			}
+
+			return;
+		}
+
+		// The iterator is not initialized, the values come from the shared arguments.
+		message.value = msg;
+		dbus_message_ref(msg);
+		message.valid = (dbus_message_get_signature(msg)[0] != 0);
+
+		shared.values = arguments;
+		shared.index = 0;
+
+	}
+
+	void DBus::Message::detach() {
+
+		if(!shared.values) {
+			return;
+		}
+
+		const auto &entries = shared.values->get();
+		if(shared.index < entries.size()) {
+			message.iter = entries[shared.index].iter;
+			message.valid = true;
+		} else {
+			message.valid = false;
+		}
+
+		shared.values.reset();
+
+	}
+
 	DBus::Message::~Message() {
 		if(message.value) {
 			dbus_message_unref(message.value);
@@ -84,6 +131,7 @@
 		if(err.valid) {
 			throw runtime_error(err.message);
 		}
+		detach();
 		return & this->message.iter;
 	}
 
@@ -93,6 +141,9 @@
 			throw runtime_error(err.message);
 		} else if(!message.valid) {
 			return false;
+		} else if(shared.values) {
+			message.valid = (++shared.index < shared.values->size());
+			return message.valid;
 		}
 		return dbus_message_iter_next(&message.iter);
 	}
@@ -103,67 +154,250 @@
 		}
 	}
 
-	static void to_value(DBusMessageIter *iter, Udjat::Value &value) {
-
-		DBusBasicValue dval;
-
-		value.clear();
-		auto type = dbus_message_iter_get_arg_type(iter);
+	/// @brief Store a basic d-bus value.
+	static void basic_to_value(int type, const DBusBasicValue &dval, Udjat::Value &value) {
 
 		switch(type) {
-		case DBUS_TYPE_INVALID:
-			throw runtime_error("Invalid d-bus value");
-
-		case DBUS_TYPE_ARRAY:
-			// TODO: Convert to Value::Array
-			// Reference: https://android.googlesource.com/platform/frameworks/base/+/a45746e/core/jni/android_bluetooth_common.cpp
-			throw system_error(ENOTSUP,system_category(),"Unsupported DBUS_TYPE_ARRAY value");
-
-		case DBUS_TYPE_DICT_ENTRY:
-			// TODO: Convert to Value::Object
-			throw system_error(ENOTSUP,system_category(),"Unsupported DBUS_TYPE_DICT_ENTRY value");
-
-		case DBUS_TYPE_VARIANT:
-			{
-				DBusMessageIter sub;
-				dbus_message_iter_recurse(iter, &sub);
-				to_value(&sub,value);
-			}
-			break;
-
 		case DBUS_TYPE_STRING:
 		case DBUS_TYPE_OBJECT_PATH:
-			dbus_message_iter_get_basic(iter,&dval);
+		case DBUS_TYPE_SIGNATURE:
 			value.set(dval.str);
 			break;
 
 		case DBUS_TYPE_BOOLEAN:
-			dbus_message_iter_get_basic(iter,&dval);
 			value.set((bool) dval.bool_val);
 			break;
 
+		case DBUS_TYPE_BYTE:
+			value.set((unsigned int) dval.byt);
+			break;
+
 		case DBUS_TYPE_INT16:
-			dbus_message_iter_get_basic(iter,&dval);
 			value.set((int) dval.i16);
 			break;
 
 		case DBUS_TYPE_INT32:
-			dbus_message_iter_get_basic(iter,&dval);
 			value.set((int) dval.i32);
 			break;
 
+		case DBUS_TYPE_UINT16:
+			value.set((unsigned int) dval.u16);
+			break;
+
 		case DBUS_TYPE_UINT32:
-			dbus_message_iter_get_basic(iter,&dval);
 			value.set((unsigned int) dval.u32);
 			break;
 
+		case DBUS_TYPE_INT64:
+			// As string, keeping every digit.
+			value.set(std::to_string((long long) dval.i64).c_str(),Udjat::Value::Signed);
+			break;
+
+		case DBUS_TYPE_UINT64:
+			value.set(std::to_string((unsigned long long) dval.u64).c_str(),Udjat::Value::Unsigned);
+			break;
+
+		case DBUS_TYPE_DOUBLE:
+			value.set(dval.dbl);
+			break;
+
 		default:
 			debug("Unsupported d-bus value type:",type," (",(char) type,")");
 			throw system_error(EINVAL, system_category(), String{"Unexpected d-bus value type '",type,"'"});
 
 		}
 
-		return;
+	}
+
+	/// @brief Get dictionary key as string.
+	static std::string key_to_string(DBusMessageIter *iter) {
+
+		DBusBasicValue dval;
+		int type = dbus_message_iter_get_arg_type(iter);
+		dbus_message_iter_get_basic(iter,&dval);
+
+		switch(type) {
+		case DBUS_TYPE_STRING:
+		case DBUS_TYPE_OBJECT_PATH:
+		case DBUS_TYPE_SIGNATURE:
+			return dval.str;
+
+		case DBUS_TYPE_BOOLEAN:
+			return dval.bool_val ? "true" : "false";
+
+		case DBUS_TYPE_BYTE:
+			return std::to_string((unsigned int) dval.byt);
+
+		case DBUS_TYPE_INT16:
+			return std::to_string(dval.i16);
+
+		case DBUS_TYPE_INT32:
+			return std::to_string(dval.i32);
+
+		case DBUS_TYPE_UINT16:
+			return std::to_string(dval.u16);
+
+		case DBUS_TYPE_UINT32:
+			return std::to_string(dval.u32);
+
+		case DBUS_TYPE_INT64:
+			return std::to_string((long long) dval.i64);
+
+		case DBUS_TYPE_UINT64:
+			return std::to_string((unsigned long long) dval.u64);
+
+		case DBUS_TYPE_DOUBLE:
+			return std::to_string(dval.dbl);
+
+		default:
+			throw system_error(EINVAL, system_category(), String{"Unexpected d-bus dictionary key type '",type,"'"});
+
+		}
+
+	}
+
+	/// @brief Append array of fixed size values, without stepping the iterator.
+	template <typename T>
+	static void fixed_to_value(DBusMessageIter *sub, int type, T DBusBasicValue::*field, Udjat::Value &value) {
+
+		const T *elements = nullptr;
+		int length = 0;
+		dbus_message_iter_get_fixed_array(sub,&elements,&length);
+
+		DBusBasicValue dval;
+		for(int ix = 0; ix < length; ix++) {
+			dval.*field = elements[ix];
+			basic_to_value(type,dval,value.append(Udjat::Value::Undefined));
+		}
+
+	}
+
+	static void to_value(DBusMessageIter *iter, Udjat::Value &value) {
+
+		DBusBasicValue dval;
+
+		auto type = dbus_message_iter_get_arg_type(iter);
+
+		switch(type) {
+		case DBUS_TYPE_INVALID:
+			throw runtime_error("Invalid d-bus value");
+
+		case DBUS_TYPE_ARRAY:
+			{
+				DBusMessageIter sub;
+				int element = dbus_message_iter_get_element_type(iter);
+				dbus_message_iter_recurse(iter, &sub);
+
+				if(element == DBUS_TYPE_DICT_ENTRY) {
+
+					// a{..}, decoded as an object, values are stored in place.
+					value.clear(Udjat::Value::Object);
+					while(dbus_message_iter_get_arg_type(&sub) == DBUS_TYPE_DICT_ENTRY) {
+						DBusMessageIter entry;
+						dbus_message_iter_recurse(&sub, &entry);
+						std::string key{key_to_string(&entry)};
+						dbus_message_iter_next(&entry);
+						to_value(&entry,value[key.c_str()]);
+						dbus_message_iter_next(&sub);
+					}
+					break;
+
+				}
+
+				value.clear(Udjat::Value::Array);
+
+				// Fixed size elements are read in one block.
+				switch(element) {
+				case DBUS_TYPE_BYTE:
+					fixed_to_value(&sub,element,&DBusBasicValue::byt,value);
+					break;
+
+				case DBUS_TYPE_BOOLEAN:
+					fixed_to_value(&sub,element,&DBusBasicValue::bool_val,value);
+					break;
+
+				case DBUS_TYPE_INT16:
+					fixed_to_value(&sub,element,&DBusBasicValue::i16,value);
+					break;
+
+				case DBUS_TYPE_UINT16:
+					fixed_to_value(&sub,element,&DBusBasicValue::u16,value);
+					break;
+
+				case DBUS_TYPE_INT32:
+					fixed_to_value(&sub,element,&DBusBasicValue::i32,value);
+					break;
+
+				case DBUS_TYPE_UINT32:
+					fixed_to_value(&sub,element,&DBusBasicValue::u32,value);
+					break;
+
+				case DBUS_TYPE_INT64:
+					fixed_to_value(&sub,element,&DBusBasicValue::i64,value);
+					break;
+
+				case DBUS_TYPE_UINT64:
+					fixed_to_value(&sub,element,&DBusBasicValue::u64,value);
+					break;
+
+				case DBUS_TYPE_DOUBLE:
+					fixed_to_value(&sub,element,&DBusBasicValue::dbl,value);
+					break;
+
+				default:
+					while(dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_INVALID) {
+						to_value(&sub,value.append(Udjat::Value::Undefined));
+						dbus_message_iter_next(&sub);
+					}
+
+				}
+
+			}
+			break;
+
+		case DBUS_TYPE_STRUCT:
+			{
+				// (..), decoded as an array of the members.
+				DBusMessageIter sub;
+				dbus_message_iter_recurse(iter, &sub);
+				value.clear(Udjat::Value::Array);
+				while(dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_INVALID) {
+					to_value(&sub,value.append(Udjat::Value::Undefined));
+					dbus_message_iter_next(&sub);
+				}
+			}
+			break;
+
+		case DBUS_TYPE_DICT_ENTRY:
+			{
+				// Only valid inside an array, decoded as an object with one member.
+				DBusMessageIter sub;
+				dbus_message_iter_recurse(iter, &sub);
+				value.clear(Udjat::Value::Object);
+				std::string key{key_to_string(&sub)};
+				dbus_message_iter_next(&sub);
+				to_value(&sub,value[key.c_str()]);
+			}
+			break;
+
+		case DBUS_TYPE_VARIANT:
+			{
+				DBusMessageIter sub;
+				dbus_message_iter_recurse(iter, &sub);
+				to_value(&sub,value);
+			}
+			break;
+
+		case DBUS_TYPE_UNIX_FD:
+			// Reading it would dup the descriptor, with nobody to close it.
+			throw system_error(ENOTSUP,system_category(),"File descriptors can't be stored on values, use pop(DBus::UnixFd &)");
+
+		default:
+			value.clear();
+			dbus_message_iter_get_basic(iter,&dval);
+			basic_to_value(type,dval,value);
+
+		}
 
 	}
 
@@ -171,6 +405,14 @@
 		if(err.valid) {
 			throw runtime_error(err.message);
 		}
+		if(shared.values) {
+			if(shared.index >= shared.values->size()) {
+				throw runtime_error("Invalid d-bus value");
+			}
+			DBusMessageIter iter = (*shared.values)[shared.index].iter;
+			to_value(&iter,value);
+			return *this;
+		}
 		to_value(&message.iter,value);
 		return *this;
 	}
@@ -194,6 +436,13 @@
 
 	int DBus::Message::get(DBusBasicValue &value) {
 
+		if(message.valid && shared.values) {
+			const auto &entry = (*shared.values)[shared.index];
+			value = entry.value;
+			message.valid = (++shared.index < shared.values->size());
+			return entry.type;
+		}
+
 		if(message.valid) {
 			int type = dbus_message_iter_get_arg_type(&message.iter);
 
@@ -242,6 +491,13 @@
 		if(!message.valid) {
 			return "";
 		}
+		if(shared.values) {
+			const auto &entry = (*shared.values)[shared.index];
+			if(!(entry.type == DBUS_TYPE_STRING || entry.type == DBUS_TYPE_OBJECT_PATH)) {
+				throw runtime_error("Message iterator is not string");
+			}
+			return String{entry.value.str};
+		}
 		return get_string(&message.iter);
 	}
 
@@ -252,12 +508,41 @@
 			throw runtime_error("Empty message");
 		}
 
+		if(shared.values) {
+			const auto &entry = (*shared.values)[shared.index];
+			if(!(entry.type == DBUS_TYPE_STRING || entry.type == DBUS_TYPE_OBJECT_PATH)) {
+				throw runtime_error("Message iterator is not string");
+			}
+			value = entry.value.str;
+			message.valid = (++shared.index < shared.values->size());
+			return *this;
+		}
+
 		value = get_string(&message.iter);
 		dbus_message_iter_next(&message.iter);
 
 		return *this;
 	}
 
+	DBus::Message & DBus::Message::pop(std::string_view &value) {
+
+		if(!message.valid) {
+			throw runtime_error("Empty message");
+		}
+
+		DBusBasicValue dval;
+		int type = get(dval);
+
+		if(!(type == DBUS_TYPE_STRING || type == DBUS_TYPE_OBJECT_PATH || type == DBUS_TYPE_SIGNATURE)) {
+			throw runtime_error("Message iterator is not string");
+		}
+
+		// Points to the message buffer.
+		value = std::string_view{dval.str};
+
+		return *this;
+	}
+
 	DBus::Message & DBus::Message::pop(int &value) {
 
 		DBusBasicValue dval;
@@ -433,6 +718,18 @@
 
 	bool DBus::Message::for_each(const std::function<bool (const Udjat::Value &value)> &call) {
 
+		if(shared.values) {
+			for(const auto &entry : shared.values->get()) {
+				Udjat::Value val;
+				DBusMessageIter iter = entry.iter;
+				to_value(&iter, val);
+				if(call(val)) {
+					return true;
+				}
+			}
+			return false;
+		}
+
 		DBusMessageIter iter;
 
 		if(!dbus_message_iter_init(this->message.value, &iter)) {
@@ -451,4 +748,95 @@
 		return false;
 	}
 
+	DBus::Cursor::Cursor(const DBusMessageIter &i) noexcept : valid{true}, iter{i} {
+	}
+
+	int DBus::Cursor::element_type() const noexcept {
+		if(type() != DBUS_TYPE_ARRAY) {
+			return DBUS_TYPE_INVALID;
+		}
+		return dbus_message_iter_get_element_type((DBusMessageIter *) &iter);
+	}
+
+	std::string DBus::Cursor::signature() const {
+
+		if(!*this) {
+			return std::string{};
+		}
+
+		char *sig = dbus_message_iter_get_signature((DBusMessageIter *) &iter);
+		std::string rc{sig};
+		dbus_free(sig);
+		return rc;
+
+	}
+
+	bool DBus::Cursor::skip() noexcept {
+		if(valid) {
+			valid = dbus_message_iter_next(&iter);
+		}
+		return valid;
+	}
+
+	DBus::Cursor DBus::Cursor::recurse() const {
+
+		switch(type()) {
+		case DBUS_TYPE_ARRAY:
+		case DBUS_TYPE_STRUCT:
+		case DBUS_TYPE_DICT_ENTRY:
+		case DBUS_TYPE_VARIANT:
+			break;
+
+		default:
+			throw runtime_error("Message iterator is not a container");
+		}
+
+		DBusMessageIter sub;
+		dbus_message_iter_recurse((DBusMessageIter *) &iter, &sub);
+
+		if(dbus_message_iter_get_arg_type(&sub) == DBUS_TYPE_INVALID) {
+			// Empty array.
+			return Cursor{};
+		}
+
+		return Cursor{sub};
+
+	}
+
+	std::string_view DBus::Cursor::view() const {
+
+		switch(type()) {
+		case DBUS_TYPE_STRING:
+		case DBUS_TYPE_OBJECT_PATH:
+		case DBUS_TYPE_SIGNATURE:
+			break;
+
+		default:
+			throw runtime_error("Message iterator is not string");
+		}
+
+		const char *str = nullptr;
+		dbus_message_iter_get_basic((DBusMessageIter *) &iter, &str);
+		return std::string_view{str};
+
+	}
+
+	void DBus::Cursor::get(Udjat::Value &value) const {
+		DBusMessageIter it = iter;
+		to_value(&it,value);
+	}
+
+	DBus::Cursor DBus::Message::args() const {
+
+		except();
+
+		DBusMessageIter iter;
+		if(!(message.value && dbus_message_iter_init(message.value, &iter))) {
+			return Cursor{};
+		}
+
+		return Cursor{iter};
+
+	}
+
  }
@@ -0,0 +1,102 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+ /**
+  * @brief Implements DBus::UnixFd.
+  */
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <udjat/tools/dbus/unixfd.h>
+ #include <system_error>
+ #include <unistd.h>
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <cerrno>
+
+ using namespace std;
+
+ namespace Udjat {
+
+	DBus::UnixFd::UnixFd(int f) noexcept : fd{f} {
+	}
+
+	DBus::UnixFd::UnixFd(UnixFd &&other) noexcept : fd{other.release()} {
+	}
+
+	DBus::UnixFd & DBus::UnixFd::operator=(UnixFd &&other) noexcept {
+		if(this != &other) {
+			reset();
+			fd = other.release();
+		}
+		return *this;
+	}
+
+	DBus::UnixFd::~UnixFd() {
+		reset();
+	}
+
+	int DBus::UnixFd::release() noexcept {
+		int rc = fd;
+		fd = -1;
+		return rc;
+	}
+
+	void DBus::UnixFd::reset() noexcept {
+		if(fd >= 0) {
+			::close(fd);
+			fd = -1;
+		}
+	}
+
+	DBus::UnixFd DBus::UnixFd::memfd(const void *data, size_t length, const char *name) {
+
+		UnixFd file{memfd_create(name,MFD_CLOEXEC|MFD_ALLOW_SEALING)};
+		if(!file) {
+			throw system_error(errno,system_category(),"Can't create memfd");
+		}
+
+		const char *ptr = (const char *) data;
+		while(length) {
+			ssize_t bytes = ::write(file.get(),ptr,length);
+			if(bytes < 0) {
+				if(errno == EINTR) {
+					continue;
+				}
+				throw system_error(errno,system_category(),"Can't write to memfd");
+			}
+			ptr += bytes;
+			length -= (size_t) bytes;
+		}
+
+		if(lseek(file.get(),0,SEEK_SET) < 0) {
+			throw system_error(errno,system_category(),"Can't rewind memfd");
+		}
+
+		if(fcntl(file.get(),F_ADD_SEALS,F_SEAL_SHRINK|F_SEAL_GROW|F_SEAL_WRITE|F_SEAL_SEAL) < 0) {
+			throw system_error(errno,system_category(),"Can't seal memfd");
+		}
+
+		return file;
+
+	}
+
+ }
+
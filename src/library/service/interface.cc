@@ -30,6 +30,7 @@
  #include <udjat/defs.h>
  #include <dbus/dbus.h>
  #include <stdexcept>
+ #include <system_error>
  #include <udjat/tools/intl.h>
  #include <udjat/tools/exception.h>
  #include <udjat/tools/value.h>
@@ -177,6 +178,10 @@
 			value.set((unsigned int) dbval.u32);
 			break;
 
+		case DBUS_TYPE_UNIX_FD:
+			// Reading it would dup the descriptor, with nobody to close it.
+			throw system_error(ENOTSUP,system_category(),"File descriptors are not supported on service arguments");
+
 		default:
 			throw runtime_error("Unexpected argument type");
 
@@ -29,7 +29,16 @@
  #include <udjat/tools/dbus/signal.h>
  #include <udjat/tools/response.h>
  #include <string>
+ #include <list>
+ #include <vector>
+ #include <chrono>
+ #include <cstring>
+ #include <unistd.h>
  #include <udjat/tools/actions/dbus.h>
+ #include <udjat/tools/dbus/interface.h>
+ #include <private/subscriptions.h>
+ #include <private/arguments.h>
+ #include <private/pending.h>
 
  using namespace Udjat;
  using namespace Udjat::DBus;
@@ -121,6 +130,956 @@
 
  }
 
+ static int dispatch_test() {
+
+	// Dispatch cost should not depend on the number of subscriptions.
+	for(size_t count : { 10, 100, 1000, 10000 }) {
+
+		std::list<DBus::Interface> interfaces;
+		std::shared_ptr<const DBus::Subscriptions> subscriptions = std::make_shared<const DBus::Subscriptions>();
+		std::shared_ptr<const DBus::Member> expected;
+
+		for(size_t ix = 0; ix < count; ix++) {
+#if __cplusplus >= 201703
+			DBus::Interface &interface = interfaces.emplace_back(String{"br.eti.werneck.udjat.Benchmark",(ix % 100)}.c_str());
+#else
+			interfaces.emplace_back(String{"br.eti.werneck.udjat.Benchmark",(ix % 100)}.c_str());
+			DBus::Interface &interface = interfaces.back();
+#endif
+			DBus::Member &member = interface.emplace_back(String{"Signal",ix}.c_str(),[](DBus::Message &){
+				return false;
+			});
+			expected = member.shared_from_this();
+			subscriptions = subscriptions->insert(interface,expected);
+		}
+
+		DBusMessage *message = dbus_message_new_signal(
+			"/br/eti/werneck/udjat/Benchmark",
+			String{"br.eti.werneck.udjat.Benchmark",((count-1) % 100)}.c_str(),
+			String{"Signal",(count-1)}.c_str()
+		);
+
+		static const size_t loops = 100000;
+		size_t found = 0;
+
+		auto start = std::chrono::steady_clock::now();
+		for(size_t ix = 0; ix < loops; ix++) {
+			if(subscriptions->find(message)) {
+				found++;
+			}
+		}
+		auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+		auto members = subscriptions->find(message);
+		dbus_message_unref(message);
+
+		if(found != loops || !members || members->size() != 1 || members->front() != expected) {
+			throw runtime_error("Dispatch table lookup failed");
+		}
+
+		// Unknown members must not match.
+		message = dbus_message_new_signal("/br/eti/werneck/udjat/Benchmark","br.eti.werneck.udjat.Benchmark0","NotThere");
+		members = subscriptions->find(message);
+		dbus_message_unref(message);
+
+		if(members && !members->empty()) {
+			throw runtime_error("Dispatch table matched an unknown member");
+		}
+
+		Logger::String{"Dispatch with ",count," subscriptions: ",(elapsed/loops),"ns per message"}.info();
+
+	}
+
+	return 0;
+
+ }
+
+ static int arguments_test() {
+
+	// Subscribers to the same signal should share the decoded arguments.
+	DBusMessage *message = dbus_message_new_signal(
+		"/br/eti/werneck/udjat/Benchmark",
+		"br.eti.werneck.udjat.Benchmark",
+		"Signal"
+	);
+
+	{
+		const char *str = "/br/eti/werneck/udjat/Benchmark/Object";
+		dbus_int32_t ival = 42;
+		dbus_bool_t bval = TRUE;
+		dbus_message_append_args(message,DBUS_TYPE_STRING,&str,DBUS_TYPE_INT32,&ival,DBUS_TYPE_BOOLEAN,&bval,DBUS_TYPE_INVALID);
+	}
+
+	static const size_t loops = 10000;
+	static const size_t subscribers = 32;
+
+	auto pop = [](DBus::Message &msg) {
+		std::string str;
+		int ival;
+		bool bval;
+		msg.pop(str).pop(ival).pop(bval);
+		if(str != "/br/eti/werneck/udjat/Benchmark/Object" || ival != 42 || !bval) {
+			throw runtime_error("Unexpected message contents");
+		}
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	for(size_t ix = 0; ix < loops; ix++) {
+		for(size_t subscriber = 0; subscriber < subscribers; subscriber++) {
+			DBus::Message msg(message);
+			pop(msg);
+		}
+	}
+	auto independent = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+	start = std::chrono::steady_clock::now();
+	for(size_t ix = 0; ix < loops; ix++) {
+		auto arguments = std::make_shared<const DBus::Arguments>(message);
+		for(size_t subscriber = 0; subscriber < subscribers; subscriber++) {
+			DBus::Message msg(arguments);
+			pop(msg);
+		}
+	}
+	auto shared = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+	{
+		// Each message has its own cursor on the shared arguments.
+		auto arguments = std::make_shared<const DBus::Arguments>(message);
+		DBus::Message first(arguments);
+		DBus::Message second(arguments);
+		std::string str;
+		int ival = 0;
+		first.pop(str);
+		pop(second);
+		first.pop(ival);
+		if(ival != 42) {
+			throw runtime_error("Shared arguments don't have independent cursors");
+		}
+	}
+
+	dbus_message_unref(message);
+
+	Logger::String{"Decoding for ",subscribers," subscribers: ",(independent/loops),"ns independent, ",(shared/loops),"ns shared"}.info();
+
+	return 0;
+
+ }
+
+ static int timeouts_test() {
+
+	// Every pending call has a libdbus timeout, they all go to the timer wheel.
+	DBusConnection *connection = SessionBus::getInstance().connection();
+
+	static const size_t calls = 50000;
+	std::vector<DBusPendingCall *> pending;
+	pending.reserve(calls);
+
+	DBusMessage *message = dbus_message_new_method_call(
+		DBUS_SERVICE_DBUS,
+		DBUS_PATH_DBUS,
+		"org.freedesktop.DBus.Peer",
+		"Ping"
+	);
+
+	auto start = std::chrono::steady_clock::now();
+	for(size_t ix = 0; ix < calls; ix++) {
+		DBusPendingCall *call = NULL;
+		if(!dbus_connection_send_with_reply(connection,message,&call,DBUS_TIMEOUT_USE_DEFAULT) || !call) {
+			dbus_message_unref(message);
+			throw runtime_error("Can't send d-bus method call");
+		}
+		pending.push_back(call);
+	}
+	auto sent = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+	start = std::chrono::steady_clock::now();
+	for(DBusPendingCall *call : pending) {
+		dbus_pending_call_cancel(call);
+		dbus_pending_call_unref(call);
+	}
+	auto cancelled = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+	dbus_message_unref(message);
+
+	Logger::String{calls," pending calls: ",(sent/calls),"ns per call, ",(cancelled/calls),"ns per cancel"}.info();
+
+	// Short timeouts on calls to a peer that never reads them, they must fire once each, in order.
+	DBusError error;
+	dbus_error_init(&error);
+	DBusConnection *silent = dbus_bus_get_private(DBUS_BUS_SESSION,&error);
+	if(!silent) {
+		Logger::String{"Can't open private connection: ",error.message}.error();
+		dbus_error_free(&error);
+		return -1;
+	}
+	dbus_connection_set_exit_on_disconnect(silent,false);
+
+	struct Expirations {
+		DBusConnection *silent;
+		std::vector<size_t> fired;
+	};
+
+	static const size_t timers = 10;
+	auto expirations = make_shared<Expirations>();
+	expirations->silent = silent;
+
+	string peer{dbus_bus_get_unique_name(silent)};
+	for(size_t ix = 0; ix < timers; ix++) {
+		SessionBus::getInstance().call(
+			DBus::Message{peer.c_str(),"/","br.eti.werneck.udjat.Test","Silent"},
+			[expirations,ix](DBus::Message &response){
+
+				if(!response.failed()) {
+					Logger::String{"Unexpected reply from the silent peer"}.error();
+				}
+
+				expirations->fired.push_back(ix);
+				if(expirations->fired.size() < timers) {
+					return;
+				}
+
+				for(size_t index = 0; index < expirations->fired.size(); index++) {
+					if(expirations->fired[index] != index) {
+						Logger::String{"Timeout ",expirations->fired[index]," fired in position ",index}.error();
+					}
+				}
+
+				if(expirations->fired.size() != timers) {
+					Logger::String{expirations->fired.size()," expirations for ",timers," timeouts"}.error();
+				} else {
+					Logger::String{timers," timeouts fired once each, in order"}.info();
+				}
+
+				if(expirations->silent) {
+					dbus_connection_close(expirations->silent);
+					dbus_connection_unref(expirations->silent);
+					expirations->silent = nullptr;
+				}
+
+			},
+			(int) ((ix+1) * 50)
+		);
+	}
+
+	return 0;
+
+ }
+
+#ifdef UDJAT_DBUS_COROUTINES
+ static DBus::Task locked_hint() {
+
+	// Sequential code, the main loop is never blocked.
+	auto session = co_await SystemBus::getInstance().call_async(
+		DBus::Message{
+			"org.freedesktop.login1",
+			"/org/freedesktop/login1",
+			"org.freedesktop.login1.Manager",
+			"GetSession",
+			"2"
+		}
+	);
+
+	session->except();
+	std::string session_path;
+	session->pop(session_path);
+
+	auto hint = co_await SystemBus::getInstance().call_async(
+		DBus::Message{
+			"org.freedesktop.login1",
+			session_path.c_str(),
+			"org.freedesktop.DBus.Properties",
+			"Get",
+			"org.freedesktop.login1.Session",
+			"LockedHint"
+		}
+	);
+
+	hint->except();
+	bool locked;
+	hint->pop(locked);
+	Logger::String{"Session is ",(locked ? "locked" : "unlocked")}.info();
+
+ }
+#endif // UDJAT_DBUS_COROUTINES
+
+ static int async_test() {
+
+	SessionBus::getInstance().call_async(
+		DBUS_SERVICE_DBUS,
+		DBUS_PATH_DBUS,
+		DBUS_INTERFACE_DBUS,
+		"GetId"
+	).then([](const std::shared_ptr<DBus::Message> &response){
+		if(response->failed()) {
+			Logger::String{"GetId failed: ",response->error_message()}.error();
+		} else {
+			Logger::String{"Bus id is ",response->to_string()}.info();
+		}
+	});
+
+#ifdef UDJAT_DBUS_COROUTINES
+	locked_hint();
+#endif // UDJAT_DBUS_COROUTINES
+
+	return 0;
+
+ }
+
+ static int batch_test() {
+
+	// One flush for all the requests, about one round trip for the batch.
+	std::vector<DBus::Connection::Method> methods;
+	for(size_t ix = 0; ix < 200; ix++) {
+		methods.push_back({DBUS_SERVICE_DBUS,DBUS_PATH_DBUS,"org.freedesktop.DBus.Peer","Ping"});
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	SessionBus::getInstance().call_batch(methods,[start](std::vector<std::shared_ptr<DBus::Message>> &responses){
+
+		size_t failed = 0;
+		for(auto &response : responses) {
+			if(response->failed()) {
+				failed++;
+			}
+		}
+
+		auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+		Logger::String{responses.size()," batched calls (",failed," failed) in ",elapsed,"us"}.info();
+
+	});
+
+	return 0;
+
+ }
+
+ static int deadline_test() {
+
+	// The nested call inherits what is left of the outer budget.
+	{
+		DBus::Deadline deadline{2000};
+
+		SessionBus::getInstance().call(DBUS_SERVICE_DBUS,DBUS_PATH_DBUS,"org.freedesktop.DBus.Peer","Ping",[](DBus::Message &){
+
+			Logger::String{"Remaining budget on reply: ",DBus::Deadline::timeout(60000),"ms"}.info();
+
+			SessionBus::getInstance().call(DBUS_SERVICE_DBUS,DBUS_PATH_DBUS,"org.freedesktop.DBus.Peer","Ping",[](DBus::Message &response){
+				Logger::String{"Nested call ",(response.failed() ? "failed" : "ok"),", remaining budget ",DBus::Deadline::timeout(60000),"ms"}.info();
+			},60000);
+
+		},60000);
+	}
+
+	// An expired deadline fails before sending.
+	DBus::Deadline expired{0};
+	try {
+		SessionBus::getInstance().call(DBUS_SERVICE_DBUS,DBUS_PATH_DBUS,"org.freedesktop.DBus.Peer","Ping",[](DBus::Message &){});
+		Logger::String{"Call with expired deadline was sent"}.error();
+		return -1;
+	} catch(const std::system_error &e) {
+		Logger::String{"Expired deadline: ",e.what()}.info();
+	}
+
+	return 0;
+
+ }
+
+ /// @brief Heap allocations counted by the test program, if it replaces operator new.
+ extern "C" size_t udjat_dbus_test_allocations() __attribute__((weak,visibility("default")));
+
+ static size_t heap_allocations() noexcept {
+	return udjat_dbus_test_allocations ? udjat_dbus_test_allocations() : 0;
+ }
+
+ static struct {
+	const size_t calls = 10000;
+	size_t baseline = 0;	///< @brief Allocations without the pool.
+	size_t before = 0;
+	std::chrono::steady_clock::time_point start;
+ } allocations;
+
+ static void allocations_chain(size_t remaining, bool pooled) {
+
+	if(!remaining) {
+
+		auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - allocations.start).count();
+		size_t count = heap_allocations() - allocations.before;
+
+		if(!pooled) {
+
+			// Baseline done, now with the pool.
+			Logger::String{allocations.calls," chained calls without the pool in ",elapsed,"us, ",count," heap allocations"}.info();
+			allocations.baseline = count;
+
+			PendingCall::pooling(true);
+			allocations.before = heap_allocations();
+			allocations.start = std::chrono::steady_clock::now();
+			allocations_chain(allocations.calls,true);
+			return;
+
+		}
+
+		Logger::String{
+			allocations.calls," chained calls with the pool in ",elapsed,"us, ",count," heap allocations (",
+			allocations.baseline," without the pool)"
+		}.info();
+
+		if(!udjat_dbus_test_allocations) {
+			Logger::String{"The test program doesn't count heap allocations"}.warning();
+		} else if(count >= allocations.baseline) {
+			Logger::String{"The pool didn't reduce the heap allocations"}.error();
+		}
+
+		return;
+	}
+
+	// Trivially copyable callback, kept inline by std::function and by the record.
+	SessionBus::getInstance().call(DBUS_SERVICE_DBUS,DBUS_PATH_DBUS,"org.freedesktop.DBus.Peer","Ping",[remaining,pooled](DBus::Message &){
+		allocations_chain(remaining-1,pooled);
+	});
+
+ }
+
+ static int allocations_test() {
+
+	// Each reply sends the next call; first with a record from the heap for every call.
+	PendingCall::pooling(false);
+	allocations.before = heap_allocations();
+	allocations.start = std::chrono::steady_clock::now();
+	allocations_chain(allocations.calls,false);
+
+	return 0;
+
+ }
+
+ static void properties_read(size_t remaining, std::chrono::steady_clock::time_point start) {
+
+	SessionBus::getInstance().get(DBUS_SERVICE_DBUS,DBUS_PATH_DBUS,DBUS_INTERFACE_DBUS,"Features",[remaining,start](DBus::Message &message){
+
+		if(message.failed()) {
+			Logger::String{"Error reading property: ",message.error_message()}.error();
+			return;
+		}
+
+		if(remaining) {
+			properties_read(remaining-1,start);
+			return;
+		}
+
+		auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+		Logger::String{"1000 property reads in ",elapsed,"us"}.info();
+
+	});
+
+ }
+
+ /// @brief Get the serial of a new message, the difference from the last one counts the messages sent.
+ static dbus_uint32_t properties_probe(DBusConnection *connection) {
+	DBusMessage *message = dbus_message_new_signal("/br/eti/werneck/udjat/Test","br.eti.werneck.udjat.Test","Probe");
+	dbus_uint32_t serial = 0;
+	dbus_connection_send(connection,message,&serial);
+	dbus_message_unref(message);
+	return serial;
+ }
+
+ static int properties_test() {
+
+	// After GetAll the reads are answered from memory, through the main loop.
+	SessionBus::getInstance().property_cache();
+
+	// Reads before the GetAll reply wait for it, they don't send Get.
+	DBusConnection *connection = SessionBus::getInstance().connection();
+	dbus_uint32_t first = properties_probe(connection);
+	for(size_t ix = 0; ix < 100; ix++) {
+		SessionBus::getInstance().get(DBUS_SERVICE_DBUS,DBUS_PATH_DBUS,DBUS_INTERFACE_DBUS,"Features",[](DBus::Message &message){
+			if(message.failed()) {
+				Logger::String{"Error reading property: ",message.error_message()}.error();
+			}
+		});
+	}
+	dbus_uint32_t sent = properties_probe(connection) - first - 1;
+
+	// GetAll and the match rules for PropertiesChanged and NameOwnerChanged.
+	if(sent > 3) {
+		Logger::String{"100 property reads sent ",sent," messages"}.error();
+		return -1;
+	}
+
+	properties_read(999,std::chrono::steady_clock::now());
+
+	return 0;
+
+ }
+
+ static int names_test() {
+
+	SessionBus::getInstance().watch_name(nullptr,[](const char *name, const char *owner){
+		Logger::String{"Owner of '",name,"' is now '",owner,"'"}.trace();
+	});
+
+	// The first call loads the registry.
+	bool running = SessionBus::getInstance().name_has_owner(DBUS_SERVICE_DBUS);
+
+	static constexpr size_t checks = 100000;
+	auto start = std::chrono::steady_clock::now();
+	for(size_t ix = 0; ix < checks; ix++) {
+		running &= SessionBus::getInstance().name_has_owner(DBUS_SERVICE_DBUS);
+	}
+	auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+	Logger::String{
+		DBUS_SERVICE_DBUS," is ",(running ? "running" : "not running"),", owner '",
+		SessionBus::getInstance().name_owner(DBUS_SERVICE_DBUS),"', ",
+		(elapsed / checks),"ns per check"
+	}.info();
+
+	return running ? 0 : -1;
+
+ }
+
+ static int introspection_test() {
+
+	auto start = std::chrono::steady_clock::now();
+	auto introspection = SessionBus::getInstance().introspect(DBUS_SERVICE_DBUS,DBUS_PATH_DBUS);
+	auto first = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+	start = std::chrono::steady_clock::now();
+	bool cached = (SessionBus::getInstance().introspect(DBUS_SERVICE_DBUS,DBUS_PATH_DBUS) == introspection);
+	auto second = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+	auto method = introspection->method(DBUS_INTERFACE_DBUS,"GetNameOwner");
+	if(!(cached && method && method->input.size() == 1 && method->output.size() == 1)) {
+		Logger::String{"Unexpected introspection data"}.error();
+		return -1;
+	}
+
+	Logger::String{
+		introspection->size()," interfaces, GetNameOwner(",method->input[0].signature.c_str(),") -> ",
+		method->output[0].signature.c_str(),", ",first,"us to load, ",second,"us from cache"
+	}.info();
+
+	return 0;
+
+ }
+
+ static int breaker_test() {
+
+	// Two failures open the circuit, the next calls don't reach the bus.
+	SessionBus::getInstance().circuit_breaker(2,1000);
+
+	int rc = 0;
+
+	for(size_t ix = 0; ix < 5; ix++) {
+		bool open = false;
+		auto start = std::chrono::steady_clock::now();
+		SessionBus::getInstance().call_and_wait("br.eti.werneck.udjat.NotThere","/","br.eti.werneck.udjat.NotThere","Ping",[&open](DBus::Message &response){
+			Logger::String{response.error_name(),": ",response.error_message()}.trace();
+			open = response.failed() && !strncmp(response.error_message(),"Circuit breaker is open",23);
+		});
+		auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+		Logger::String{"Call ",(ix+1)," failed in ",elapsed,"us"}.info();
+
+		if(open != (ix >= 2)) {
+			Logger::String{"Call ",(ix+1),(open ? " was" : " wasn't")," refused by the circuit breaker"}.error();
+			rc = -1;
+		}
+	}
+
+	{
+		// Refused asynchronous calls are answered from the main loop, never from inside call().
+		auto flag = make_shared<bool>(false);
+		SessionBus::getInstance().call("br.eti.werneck.udjat.NotThere","/","br.eti.werneck.udjat.NotThere","Ping",[flag](DBus::Message &){
+			*flag = true;
+		});
+
+		if(*flag) {
+			Logger::String{"Refused call was answered from inside call()"}.error();
+			rc = -1;
+		}
+	}
+
+	SessionBus::getInstance().circuit_breaker(0);
+
+	return rc;
+
+ }
+
+ static int single_flight_test() {
+
+	// Identical calls sent before the first reply share it; ping ourselves, the bus is never shared.
+	SessionBus::getInstance().single_flight();
+
+	string self{dbus_bus_get_unique_name(SessionBus::getInstance().connection())};
+	auto remaining = make_shared<size_t>(100);
+
+	DBus::Connection::SingleFlight shared;
+	for(size_t ix = 0; ix < 100; ix++) {
+		SessionBus::getInstance().call(self.c_str(),"/","org.freedesktop.DBus.Peer","Ping",[remaining](DBus::Message &response){
+			if(response.failed()) {
+				Logger::String{"Error on ping: ",response.error_message()}.error();
+			}
+			if(--(*remaining) == 0) {
+				auto statistics = SessionBus::getInstance().single_flight_statistics();
+				Logger::String{"100 calls, ",statistics.sent," sent to the bus, ",statistics.joined," joined"}.info();
+				if(statistics.sent + statistics.joined != 100) {
+					Logger::String{"Single-flight counters don't match the calls"}.error();
+				}
+				SessionBus::getInstance().single_flight(false);
+			}
+		});
+	}
+
+	return 0;
+
+ }
+
+ static int throttle_test() {
+
+	// Ping ourselves, libdbus answers on the peer interface; only 4 at a time.
+	SessionBus::getInstance().max_in_flight(4);
+
+	string self{dbus_bus_get_unique_name(SessionBus::getInstance().connection())};
+	auto remaining = make_shared<size_t>(100);
+
+	auto answered = [remaining,self](DBus::Message &response){
+		if(response.failed()) {
+			Logger::String{"Error on ping: ",response.error_message()}.error();
+		}
+		if(--(*remaining) == 0) {
+			auto statistics = SessionBus::getInstance().queue_statistics(self.c_str());
+			Logger::String{
+				"100 calls, ",statistics.delayed," queued, max depth ",statistics.max_queued,
+				", average wait ",(statistics.delayed ? (statistics.wait.count() / statistics.delayed) : 0),"us",
+				", max wait ",statistics.max_wait.count(),"us"
+			}.info();
+			if(statistics.max_in_flight > 4) {
+				Logger::String{statistics.max_in_flight," calls were in flight, the limit is 4"}.error();
+			}
+			SessionBus::getInstance().max_in_flight(0);
+		}
+	};
+
+	for(size_t ix = 0; ix < 80; ix++) {
+		SessionBus::getInstance().call(self.c_str(),"/","org.freedesktop.DBus.Peer","Ping",answered);
+	}
+
+	// A burst from call_batch() goes through the same limit.
+	std::vector<DBus::Connection::Method> methods(20,DBus::Connection::Method{self.c_str(),"/","org.freedesktop.DBus.Peer","Ping"});
+	SessionBus::getInstance().call_batch(methods,[answered](size_t, DBus::Message &response){
+		answered(response);
+	});
+
+	auto statistics = SessionBus::getInstance().queue_statistics(self.c_str());
+	if(statistics.max_in_flight > 4) {
+		Logger::String{statistics.max_in_flight," calls were in flight, the limit is 4"}.error();
+		return -1;
+	}
+
+	return 0;
+
+ }
+
+ static void decode_benchmark(DBus::Message &response, const char *name, size_t elements) {
+
+	static constexpr size_t cycles = 100;
+	size_t values = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for(size_t ix = 0; ix < cycles; ix++) {
+		response.for_each([&values](const Udjat::Value &) {
+			values++;
+			return false;
+		});
+	}
+	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+	size_t found = 0;
+	for(auto arg : response.args()) {
+		for(auto element : arg.recurse()) {
+			(void) element;
+			found++;
+		}
+	}
+
+	if(values != cycles || found != elements) {
+		throw runtime_error(Logger::String{name,": expected one array with ",elements," element(s), found ",(values/cycles)," argument(s) with ",found});
+	}
+
+	Logger::String{name,": ",elements," element(s) decoded in ",(elapsed/cycles),"us"}.info();
+
+ }
+
+ static int containers_test() {
+
+	SessionBus::getInstance().call_and_wait(DBUS_SERVICE_DBUS,DBUS_PATH_DBUS,DBUS_INTERFACE_DBUS,"ListNames",[](DBus::Message &response){
+		response.except();
+		std::vector<std::string> names;
+		DBus::Message{(DBusMessage *) response}.pop(names);
+		decode_benchmark(response,"ListNames (as)",names.size());
+	});
+
+	// Built locally, with the shapes of systemd's GetAll and ListUnits replies.
+	static constexpr size_t entries = 200;
+
+	{
+		DBusMessage *message = dbus_message_new_signal("/br/eti/werneck/udjat/Test","br.eti.werneck.udjat.Test","GetAll");
+		DBusMessageIter iter, array, entry, variant;
+
+		dbus_message_iter_init_append(message,&iter);
+		dbus_message_iter_open_container(&iter,DBUS_TYPE_ARRAY,"{sv}",&array);
+		for(size_t ix = 0; ix < entries; ix++) {
+			std::string key{String{"Property",ix}};
+			const char *str = key.c_str();
+			dbus_uint32_t value = ix;
+			dbus_message_iter_open_container(&array,DBUS_TYPE_DICT_ENTRY,NULL,&entry);
+			dbus_message_iter_append_basic(&entry,DBUS_TYPE_STRING,&str);
+			dbus_message_iter_open_container(&entry,DBUS_TYPE_VARIANT,"u",&variant);
+			dbus_message_iter_append_basic(&variant,DBUS_TYPE_UINT32,&value);
+			dbus_message_iter_close_container(&entry,&variant);
+			dbus_message_iter_close_container(&array,&entry);
+		}
+		dbus_message_iter_close_container(&iter,&array);
+
+		DBus::Message response{message};
+		dbus_message_unref(message);
+		decode_benchmark(response,"GetAll (a{sv})",entries);
+	}
+
+	{
+		DBusMessage *message = dbus_message_new_signal("/br/eti/werneck/udjat/Test","br.eti.werneck.udjat.Test","ListUnits");
+		DBusMessageIter iter, array, unit;
+
+		dbus_message_iter_init_append(message,&iter);
+		dbus_message_iter_open_container(&iter,DBUS_TYPE_ARRAY,"(ssssssouso)",&array);
+		for(size_t ix = 0; ix < entries; ix++) {
+			std::string name{String{"unit",ix,".service"}};
+			const char *str = name.c_str();
+			const char *text = "loaded";
+			const char *path = "/br/eti/werneck/udjat/Test";
+			dbus_uint32_t job = ix;
+			dbus_message_iter_open_container(&array,DBUS_TYPE_STRUCT,NULL,&unit);
+			dbus_message_iter_append_basic(&unit,DBUS_TYPE_STRING,&str);
+			for(size_t field = 0; field < 5; field++) {
+				dbus_message_iter_append_basic(&unit,DBUS_TYPE_STRING,&text);
+			}
+			dbus_message_iter_append_basic(&unit,DBUS_TYPE_OBJECT_PATH,&path);
+			dbus_message_iter_append_basic(&unit,DBUS_TYPE_UINT32,&job);
+			dbus_message_iter_append_basic(&unit,DBUS_TYPE_STRING,&text);
+			dbus_message_iter_append_basic(&unit,DBUS_TYPE_OBJECT_PATH,&path);
+			dbus_message_iter_close_container(&array,&unit);
+		}
+		dbus_message_iter_close_container(&iter,&array);
+
+		DBus::Message response{message};
+		dbus_message_unref(message);
+		decode_benchmark(response,"ListUnits (a(ssssssouso))",entries);
+	}
+
+	return 0;
+
+ }
+
+ struct MarshalPoint {
+	int32_t x;
+	int32_t y;
+ };
+
+ template <> struct Udjat::DBus::Type<MarshalPoint> : Udjat::DBus::Fields<MarshalPoint,&MarshalPoint::x,&MarshalPoint::y> {};
+
+ static int marshal_test() {
+
+	typedef std::tuple<std::string,std::map<std::string,std::vector<int32_t>>,std::optional<MarshalPoint>,uint64_t> Payload;
+	static_assert(std::string_view{DBus::Type<Payload>::signature.c_str()} == "(sa{sai}a(ii)t)","Unexpected signature");
+	Logger::String{"Payload signature: ",DBus::Type<Payload>::signature.c_str()}.info();
+
+	std::vector<double> samples(100000);
+	for(size_t ix = 0; ix < samples.size(); ix++) {
+		samples[ix] = (double) ix;
+	}
+
+	DBus::Message request{DBUS_SERVICE_DBUS,DBUS_PATH_DBUS,DBUS_INTERFACE_DBUS,"Marshal"};
+
+	auto start = std::chrono::steady_clock::now();
+	request.push_back(samples);
+	request.push_back(Payload{"payload",{{"first",{1,2,3}},{"second",{}}},MarshalPoint{10,20},UINT64_MAX});
+	request.push_back(MarshalPoint{1,2});
+
+	DBus::Message reader{(DBusMessage *) request};
+	std::vector<double> decoded;
+	Payload payload;
+	MarshalPoint point{0,0};
+	reader.pop(decoded).pop(payload).pop(point);
+	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+	if(decoded != samples || std::get<1>(payload)["first"].size() != 3 || !std::get<2>(payload) || std::get<3>(payload) != UINT64_MAX || point.y != 2) {
+		Logger::String{"Typed values don't match"}.error();
+		return -1;
+	}
+
+	Logger::String{samples.size()," doubles and a struct marshalled in ",elapsed,"us"}.info();
+
+	{
+		// Narrow integers keep the signature they had before the typed push_back.
+		DBus::Message message{DBUS_SERVICE_DBUS,DBUS_PATH_DBUS,DBUS_INTERFACE_DBUS,"Narrow"};
+		message.push_back((uint8_t) 1).push_back((int16_t) 2).push_back((uint16_t) 3);
+
+		DBus::Signal signal{"br.eti.werneck.udjat.Test","Narrow","/"};
+		signal.push_back((uint8_t) 1).push_back((int16_t) 2).push_back((uint16_t) 3);
+
+		if(strcmp(dbus_message_get_signature((DBusMessage *) message),"iii") || strcmp(dbus_message_get_signature(signal.dbus_message()),"inq")) {
+			Logger::String{"Unexpected signature for narrow integers"}.error();
+			return -1;
+		}
+	}
+
+	{
+		// Classes derived from std::string still read object paths.
+		DBus::Message message{DBUS_SERVICE_DBUS,DBUS_PATH_DBUS,DBUS_INTERFACE_DBUS,"Path"};
+		const char *path = "/br/eti/werneck/udjat/Test";
+		dbus_message_append_args((DBusMessage *) message,DBUS_TYPE_OBJECT_PATH,&path,DBUS_TYPE_INVALID);
+
+		DBus::Message reader{(DBusMessage *) message};
+		String value;
+		reader.pop(value);
+
+		if(strcmp(value.c_str(),path)) {
+			Logger::String{"Unexpected object path on String"}.error();
+			return -1;
+		}
+	}
+
+	auto names = SessionBus::getInstance().call<std::vector<std::string>>(DBUS_SERVICE_DBUS,DBUS_PATH_DBUS,DBUS_INTERFACE_DBUS,"ListNames");
+	auto pid = SessionBus::getInstance().call<uint32_t>(DBUS_SERVICE_DBUS,DBUS_PATH_DBUS,DBUS_INTERFACE_DBUS,"GetConnectionUnixProcessID",std::string{DBUS_SERVICE_DBUS});
+	Logger::String{names.size()," names on the session bus, the daemon is pid ",pid}.info();
+
+	return 0;
+
+ }
+
+ static int span_test() {
+
+	std::vector<uint8_t> payload(16*1024*1024,0x55);
+	std::string text(1024*1024,'x');
+
+	DBus::Message request{DBUS_SERVICE_DBUS,DBUS_PATH_DBUS,DBUS_INTERFACE_DBUS,"Span"};
+
+	auto start = std::chrono::steady_clock::now();
+	request.push_back(DBus::Span<uint8_t>{payload}).push_back(text);
+
+	DBus::Message reader{(DBusMessage *) request};
+	DBus::Span<uint8_t> bytes;
+	std::string_view view;
+	reader.pop(bytes).pop(view);
+	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+	if(bytes.size() != payload.size() || bytes[0] != 0x55 || view.size() != text.size()) {
+		Logger::String{"Span values don't match"}.error();
+		return -1;
+	}
+
+	Logger::String{bytes.size()," bytes and a ",view.size()," bytes string sent and read in ",elapsed,"us"}.info();
+
+	return 0;
+
+ }
+
+ static int unixfd_test() {
+
+	if(!SessionBus::getInstance().can_send_type(DBUS_TYPE_UNIX_FD)) {
+		Logger::String{"The session bus can't pass file descriptors"}.warning();
+	}
+
+	std::string report(4*1024*1024,'r');
+
+	auto start = std::chrono::steady_clock::now();
+
+	DBus::Message request{DBUS_SERVICE_DBUS,DBUS_PATH_DBUS,DBUS_INTERFACE_DBUS,"UnixFd"};
+	request.push_back(DBus::UnixFd::memfd(report.data(),report.size(),"report"));
+
+	DBus::Message reader{(DBusMessage *) request};
+	DBus::UnixFd file;
+	reader.pop(file);
+
+	std::string received(report.size(),' ');
+	ssize_t bytes = ::read(file.get(),&received[0],received.size());
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+	if(bytes != (ssize_t) report.size() || received != report) {
+		Logger::String{"Unexpected memfd contents"}.error();
+		return -1;
+	}
+
+	// Sealed, the receiver can't change it.
+	if(::write(file.get(),"x",1) >= 0) {
+		Logger::String{"The memfd isn't sealed"}.error();
+		return -1;
+	}
+
+	Logger::String{report.size()," bytes passed on a memfd in ",elapsed,"us"}.info();
+
+	return 0;
+
+ }
+
+ static int cursor_test() {
+
+	SessionBus::getInstance().call_and_wait(DBUS_SERVICE_DBUS,DBUS_PATH_DBUS,DBUS_INTERFACE_DBUS,"ListNames",[](DBus::Message &response){
+
+		response.except();
+
+		static constexpr size_t cycles = 100;
+
+		// Walk the array, looking only at the first character of each name.
+		size_t unique = 0;
+		auto start = std::chrono::steady_clock::now();
+		for(size_t ix = 0; ix < cycles; ix++) {
+			for(auto arg : response.args()) {
+				if(arg.type() != DBUS_TYPE_ARRAY) {
+					continue;
+				}
+				for(auto name : arg.recurse()) {
+					if(name.view()[0] == ':') {
+						unique++;
+					}
+				}
+			}
+		}
+		auto lazy = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+		// The same with the values fully decoded.
+		start = std::chrono::steady_clock::now();
+		for(size_t ix = 0; ix < cycles; ix++) {
+			response.for_each([](const Udjat::Value &) {
+				return false;
+			});
+		}
+		auto eager = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+		// The cursor must see the same names as the typed decoder.
+		std::vector<std::string> names;
+		DBus::Message{(DBusMessage *) response}.pop(names);
+		size_t expected = 0;
+		for(const auto &name : names) {
+			if(name[0] == ':') {
+				expected++;
+			}
+		}
+
+		if(unique != (expected * cycles)) {
+			throw runtime_error(Logger::String{"Cursor found ",(unique/cycles)," unique names, expected ",expected});
+		}
+
+		Logger::String{
+			(unique/cycles)," unique names; cursor scan in ",(lazy/cycles),"us, full decode in ",(eager/cycles),"us"
+		}.info();
+
+	});
+
+	return 0;
+
+ }
+
  UDJAT_API int run_udjat_unit_test(const char *name) {
 
 	static const struct {
@@ -128,6 +1087,24 @@
 		int (*test)();
 	} tests[] = {
 		{"call_and_wait",call_and_wait_test},
+		{"dispatch",dispatch_test},
+		{"arguments",arguments_test},
+		{"timeouts",timeouts_test},
+		{"async",async_test},
+		{"batch",batch_test},
+		{"deadline",deadline_test},
+		{"allocations",allocations_test},
+		{"properties",properties_test},
+		{"names",names_test},
+		{"introspection",introspection_test},
+		{"breaker",breaker_test},
+		{"single_flight",single_flight_test},
+		{"throttle",throttle_test},
+		{"containers",containers_test},
+		{"marshal",marshal_test},
+		{"span",span_test},
+		{"unixfd",unixfd_test},
+		{"cursor",cursor_test},
 	};
 
 	Logger::String{"Running unit test: ",name}.info();
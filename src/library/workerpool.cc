@@ -0,0 +1,112 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2026 Perry Werneck <perry.werneck@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+ /**
+  * @brief Implements the d-bus worker pool.
+  */
+
+ #include <config.h>
+ #include <udjat/defs.h>
+ #include <udjat/tools/logger.h>
+ #include <private/workerpool.h>
+
+ using namespace std;
+ using namespace Udjat;
+
+ WorkerPool::WorkerPool() : limit{std::thread::hardware_concurrency()} {
+	if(limit < 2) {
+		limit = 2;
+	}
+ }
+
+ WorkerPool::~WorkerPool() {
+
+	{
+		lock_guard<mutex> lock(guard);
+		running = false;
+	}
+
+	wakeup.notify_all();
+
+	for(auto &thread : threads) {
+		thread.join();
+	}
+
+ }
+
+ WorkerPool & WorkerPool::getInstance() {
+	static WorkerPool instance;
+	return instance;
+ }
+
+ void WorkerPool::push(std::function<void()> task) {
+
+	{
+		lock_guard<mutex> lock(guard);
+		tasks.push_back(std::move(task));
+
+		// Idle workers take one task each, spawn for the ones they can't take.
+		if(tasks.size() > idle && threads.size() < limit) {
+			Logger::String{"Starting d-bus worker ",(threads.size()+1),"/",limit}.trace("d-bus");
+			threads.emplace_back(&WorkerPool::worker,this);
+		}
+	}
+
+	wakeup.notify_one();
+
+ }
+
+ void WorkerPool::worker() {
+
+	unique_lock<mutex> lock(guard);
+
+	while(running) {
+
+		if(tasks.empty()) {
+			idle++;
+			wakeup.wait(lock,[this]{ return !(running && tasks.empty()); });
+			idle--;
+			continue;
+		}
+
+		auto task = std::move(tasks.front());
+		tasks.pop_front();
+
+		lock.unlock();
+
+		try {
+
+			task();
+
+		} catch(const std::exception &e) {
+
+			Logger::String{"Worker task failed: ",e.what()}.error("d-bus");
+
+		} catch(...) {
+
+			Logger::String{"Worker task failed: Unexpected error"}.error("d-bus");
+
+		}
+
+		lock.lock();
+
+	}
+
+ }
+
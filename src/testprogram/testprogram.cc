@@ -24,9 +24,36 @@
  #include <udjat/module/dbus.h>
  #include <udjat/tools/dbus/service.h>
  #include <udjat/tools/dbus/connection.h>
+ #include <atomic>
+ #include <cstdlib>
+ #include <new>
  
  using namespace Udjat;
 
+ /// @brief Heap allocations, for the allocations unit test.
+ static std::atomic<size_t> allocations{0};
+
+ extern "C" size_t udjat_dbus_test_allocations() {
+	return allocations;
+ }
+
+ void * operator new(size_t size) {
+	allocations++;
+	void *ptr = malloc(size ? size : 1);
+	if(!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+ }
+
+ void operator delete(void *ptr) noexcept {
+	free(ptr);
+ }
+
+ void operator delete(void *ptr, size_t) noexcept {
+	free(ptr);
+ }
+
  int main(int argc, char **argv) {
 	
 	return loader(argc,argv, [](Application &app) -> int {